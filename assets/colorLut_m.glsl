@@ -0,0 +1,7 @@
+// Per-projector color correction, through a 3D lookup table
+// The color is remapped onto the texel centers so that the LUT's end points are hit exactly
+vec3 applyColorLut(in sampler3D lut, in float lutSize, in vec3 color) {
+  vec3 scale = vec3((lutSize - 1.0) / lutSize);
+  vec3 offset = vec3(0.5 / lutSize);
+  return texture(lut, clamp(color, 0.0, 1.0) * scale + offset).rgb;
+}
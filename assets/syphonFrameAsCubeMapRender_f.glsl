@@ -1,6 +1,7 @@
 #version 410
 
 #include "alphaBlend_m.glsl"
+#include "colorLut_m.glsl"
 
 in vec4 aWorldSpacePosition;
 in vec3 aWorldSpaceNormal;
@@ -29,6 +30,9 @@ uniform vec3 uProjectorPos;
   };
 
   uniform int uNumProjectors;
+#else
+  uniform sampler3D uColorLut;
+  uniform float uColorLutSize;
 #endif
 
 vec4 getProjectorValue(in vec3 toProjector, in vec3 normal, in vec4 color) {
@@ -53,6 +57,7 @@ void main() {
     FragColor = vec4(baseColor.rgb, 1.0);
   #else
     // FragColor = getProjectorValue(normalize(uProjectorPos - aWorldSpacePosition.xyz), normal, texture(uCubeMapTex, aCubeMapTexCoord));
-    FragColor = texture(uCubeMapTex, aCubeMapTexCoord);
+    vec4 texColor = texture(uCubeMapTex, aCubeMapTexCoord);
+    FragColor = vec4(applyColorLut(uColorLut, uColorLutSize, texColor.rgb), texColor.a);
   #endif
 }
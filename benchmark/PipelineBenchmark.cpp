@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cinder/GeomIo.h"
+
+#include "Benchmark.h"
+#include "ColorCorrection.h"
+#include "ParamsControl.h"
+#include "SphereMesh.h"
+
+using namespace ci;
+using std::string;
+using std::vector;
+
+// The CPU stages of the projection pipeline, without a window or a GL context, so they can be timed on
+// any machine (the GL stages are in the app's --benchmark mode).
+//
+// Usage: PipelineBenchmark [--output benchmark.json] [--baseline old.json] [--tolerance 0.1] [--assets dir]
+// Exits with 2 if anything is slower than the baseline, and with 1 if something failed.
+int main(int argc, char * argv[]) {
+	vector<string> args(argv + 1, argv + argc);
+	auto argValue = [&args] (string flag, string defaultValue) {
+		auto flagPosition = std::find(args.begin(), args.end(), flag);
+		return (flagPosition != args.end() && flagPosition + 1 != args.end()) ? * (flagPosition + 1) : defaultValue;
+	};
+
+	fs::path outputFile = argValue("--output", "benchmark.json");
+	fs::path baselineFile = argValue("--baseline", "");
+	double tolerance = std::stod(argValue("--tolerance", "0.1"));
+	fs::path assetsDir = argValue("--assets", ASSETS_PATH);
+
+	BenchmarkSuite suite;
+
+	try {
+		DataSourceRef objSource = loadFile(assetsDir / "sphere_scan_2017_03_02/sphere_scan_2017_03_02_edited.obj");
+		suite.run("objLoad", [&] () { loadSphereMesh(objSource); }, 3);
+	} catch (std::exception const & exc) {
+		std::cerr << "ERROR: could not load the sphere mesh from " << assetsDir << ": " << exc.what() << std::endl;
+		return BenchmarkSuite::FAILED;
+	}
+
+	for (int subdivisions : { 32, 128, 512 }) {
+		TriMesh mesh(geom::Sphere().subdivisions(subdivisions), TriMesh::Format().positions().texCoords1(3));
+		suite.run("texCoordGen/" + std::to_string(mesh.getNumVertices()), [&] () { generateCubeMapTexCoords(mesh, MAGIC_SPHERE_ORIGIN); });
+	}
+
+	// Rebaked whenever a projector's gamma or white point is edited
+	for (int lutSize : { 17, 33, 65 }) {
+		vector<float> lut(lutSize * lutSize * lutSize * 3);
+		suite.run("lutBake/" + std::to_string(lutSize), [&] () {
+			bakeColorCorrectionLut(lut.data(), lutSize, nullptr, vec3(2.2f), Color(0.95f, 1.0f, 0.9f));
+		});
+	}
+
+	// A full HD frame through the baked table on the CPU, the same lookup the projector shader does
+	{
+		size_t const numPixels = 1920 * 1080;
+		vector<float> frame(numPixels * 3);
+		for (size_t i = 0; i < frame.size(); i++) {
+			frame[i] = (float) ((i * 7919) % 1024) / 1023.0f;
+		}
+		vector<float> corrected(frame.size());
+		for (int lutSize : { 17, 65 }) {
+			vector<float> lut(lutSize * lutSize * lutSize * 3);
+			bakeColorCorrectionLut(lut.data(), lutSize, nullptr, vec3(2.2f), Color(0.95f, 1.0f, 0.9f));
+			suite.run("lutApply/" + std::to_string(lutSize) + "/1920x1080", [&] () {
+				applyColorLut(lut.data(), lutSize, frame.data(), corrected.data(), numPixels);
+			});
+		}
+	}
+
+	for (int count : { 3, 30, 300 }) {
+		vector<ProjectorRef> projectors = makeBenchmarkProjectors(count);
+		std::map<int, ColorCorrectionRef> corrections;
+		for (auto & proj : projectors) {
+			corrections[proj->getId()] = std::make_shared<ColorCorrection>();
+		}
+
+		string serializedParams;
+		suite.run("paramsSerialize/" + std::to_string(count), [&] () {
+			serializedParams = serializeAllProjectorParams(projectors, corrections).serialize();
+		});
+
+		// None of the projectors have a LUT file, so parseColorCorrection never needs the app
+		suite.run("paramsParse/" + std::to_string(count), [&] () {
+			JsonTree paramsTree(serializedParams);
+			for (auto const & projParams : paramsTree) {
+				parseProjectorParams(projParams);
+				parseColorCorrection(nullptr, projParams);
+			}
+		});
+
+		suite.run("projectorMatrices/" + std::to_string(count), [&] () {
+			for (auto & proj : projectors) {
+				proj->moveTo(proj->getPos() + vec3(0, 0.001f, 0));
+				proj->getViewMatrix();
+				proj->getProjectionMatrix();
+			}
+		});
+	}
+
+	return suite.writeResults(outputFile, baselineFile, tolerance);
+}
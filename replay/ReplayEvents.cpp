@@ -0,0 +1,23 @@
+#include <cstdlib>
+#include <iostream>
+
+#include "EventLog.h"
+
+using namespace ci;
+
+// Replays a calibration event log without the app, so no window or GL context is ever created.
+//
+// Usage: ReplayEvents calibrationEvents.log [output.json] [assets dir]
+// The assets dir is where the LUT files are loaded from, and defaults to the repo's assets.
+int main(int argc, char * argv[]) {
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0] << " calibrationEvents.log [output.json] [assets dir]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	fs::path logFile = argv[1];
+	fs::path outputFile = argc > 2 ? argv[2] : "replayedParams.json";
+	fs::path assetsDir = argc > 3 ? argv[3] : ASSETS_PATH;
+
+	return replayEventLog(logFile, outputFile, assetsDir);
+}
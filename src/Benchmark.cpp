@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+#include "cinder/DataSource.h"
+
+#include "Benchmark.h"
+
+using namespace ci;
+using std::string;
+using std::vector;
+
+void BenchmarkSuite::run(string name, std::function<void()> fn, int iterations) {
+	fn();
+
+	vector<double> timesMs;
+	for (int iter = 0; iter < iterations; iter++) {
+		auto start = std::chrono::steady_clock::now();
+		fn();
+		auto end = std::chrono::steady_clock::now();
+		timesMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+	std::sort(timesMs.begin(), timesMs.end());
+
+	Result result = { name, iterations, timesMs[timesMs.size() / 2], timesMs.front(), timesMs.back() };
+	mResults.push_back(result);
+
+	std::cout << "benchmark " << name << ": " << result.medianMs << " ms (min " << result.minMs << ", max " << result.maxMs << ")" << std::endl;
+}
+
+JsonTree BenchmarkSuite::getResults() const {
+	JsonTree resultList = JsonTree::makeArray("benchmarks");
+	for (auto & result : mResults) {
+		resultList.addChild(JsonTree::makeObject()
+			.addChild(JsonTree("name", result.name))
+			.addChild(JsonTree("iterations", result.iterations))
+			.addChild(JsonTree("medianMs", result.medianMs))
+			.addChild(JsonTree("minMs", result.minMs))
+			.addChild(JsonTree("maxMs", result.maxMs)));
+	}
+	return JsonTree::makeObject().addChild(resultList);
+}
+
+vector<string> BenchmarkSuite::compare(JsonTree const & results, JsonTree const & baseline, double tolerance) {
+	vector<string> regressions;
+
+	for (auto const & result : results.getChild("benchmarks")) {
+		string name = result.getValueForKey("name");
+		auto const & baselineList = baseline.getChild("benchmarks");
+		auto baselineResult = std::find_if(baselineList.begin(), baselineList.end(), [&] (JsonTree const & entry) { return entry.getValueForKey("name") == name; });
+		if (baselineResult == baselineList.end()) {
+			continue;
+		}
+
+		double currentMs = result.getValueForKey<double>("medianMs");
+		double baselineMs = baselineResult->getValueForKey<double>("medianMs");
+		if (currentMs > baselineMs * (1.0 + tolerance)) {
+			std::cout << "SLOWER: " << name << " took " << currentMs << " ms, baseline was " << baselineMs << " ms" << std::endl;
+			regressions.push_back(name);
+		}
+	}
+
+	return regressions;
+}
+
+int BenchmarkSuite::writeResults(fs::path const & outputFile, fs::path const & baselineFile, double tolerance) const {
+	JsonTree results = getResults();
+	int exitCode = SUCCESS;
+
+	if (!baselineFile.empty()) {
+		try {
+			vector<string> regressions = compare(results, JsonTree(loadFile(baselineFile)), tolerance);
+			JsonTree regressionList = JsonTree::makeArray("regressions");
+			for (auto & name : regressions) {
+				regressionList.addChild(JsonTree("", name));
+			}
+			results.addChild(regressionList);
+			std::cout << regressions.size() << " benchmark(s) more than " << tolerance * 100.0 << "% slower than " << baselineFile << std::endl;
+			if (!regressions.empty()) {
+				exitCode = SLOWER;
+			}
+		} catch (std::exception const & exc) {
+			std::cerr << "ERROR: could not compare against the baseline " << baselineFile << ": " << exc.what() << std::endl;
+			exitCode = FAILED;
+		}
+	}
+
+	std::ofstream writeFile(outputFile.string());
+	writeFile << results.serialize();
+	writeFile.close();
+	if (!writeFile) {
+		std::cerr << "ERROR: could not write the benchmark results to " << outputFile << std::endl;
+		return FAILED;
+	}
+
+	std::cout << "wrote benchmark results to: " << outputFile << std::endl;
+	return exitCode;
+}
+
+vector<ProjectorRef> makeBenchmarkProjectors(int count) {
+	vector<ProjectorRef> projectors;
+	for (int idx = 0; idx < count; idx++) {
+		projectors.push_back(std::make_shared<Projector>(getAcerP5515MinZoom()));
+		projectors.back()->moveTo(vec3(2, 0, 6.28f * idx / count))
+			.setColor(Color(CM_HSV, (float) idx / count, 0.95f, 0.95f))
+			.setId(idx);
+	}
+	return projectors;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "cinder/Filesystem.h"
+#include "cinder/Json.h"
+
+#include "Projector.h"
+
+// Collects timings for the benchmark runs, and compares them against a previous run.
+// Nothing in here needs a window or a GL context, so it's shared by the app's --benchmark mode
+// and the headless PipelineBenchmark.
+class BenchmarkSuite {
+public:
+	// Exit codes for the benchmark runs, so scripts can tell a slowdown apart from a failure
+	enum ExitCode {
+		SUCCESS = 0,
+		FAILED = 1,
+		SLOWER = 2
+	};
+
+	// Runs fn once to warm up, then the given number of times, and records the median time
+	void run(std::string name, std::function<void()> fn, int iterations = 10);
+
+	ci::JsonTree getResults() const;
+
+	// Prints every benchmark whose median is more than (1 + tolerance) times the baseline's, and
+	// returns their names. Benchmarks missing from the baseline are skipped.
+	static std::vector<std::string> compare(ci::JsonTree const & results, ci::JsonTree const & baseline, double tolerance);
+
+	// Writes the results (plus the list of regressions, if there's a baseline) to outputFile, and returns the exit code
+	int writeResults(ci::fs::path const & outputFile, ci::fs::path const & baselineFile, double tolerance) const;
+
+private:
+	struct Result {
+		std::string name;
+		int iterations;
+		double medianMs;
+		double minMs;
+		double maxMs;
+	};
+
+	std::vector<Result> mResults;
+};
+
+// Projectors spread around the sphere, roughly like the real rig
+std::vector<ProjectorRef> makeBenchmarkProjectors(int count);
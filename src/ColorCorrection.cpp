@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+#include "cinder/Utilities.h"
+
+#include "ColorCorrection.h"
+
+using namespace ci;
+using std::string;
+using std::vector;
+
+// The .cube spec allows 2 to 256 entries per side. Anything else is a broken file, and a huge size would
+// have us reserve gigabytes before finding that out.
+static const int MIN_CUBE_LUT_SIZE = 2;
+static const int MAX_CUBE_LUT_SIZE = 256;
+
+ColorCorrection::ColorCorrection()
+: mGamma(1.0f), mWhitePoint(1.0f, 1.0f, 1.0f), mLutSize(DEFAULT_LUT_SIZE) {}
+
+ColorCorrection & ColorCorrection::setGamma(vec3 gamma) {
+	mGamma = gamma;
+	mLutDirty = true;
+	return * this;
+}
+
+ColorCorrection & ColorCorrection::setWhitePoint(Color whitePoint) {
+	mWhitePoint = whitePoint;
+	mLutDirty = true;
+	return * this;
+}
+
+ColorCorrection & ColorCorrection::setBaseLut(vector<float> baseLut, int lutSize, string lutFile) {
+	mBaseLut = std::move(baseLut);
+	mLutSize = mBaseLut.empty() ? DEFAULT_LUT_SIZE : lutSize;
+	// The file name is kept even if it couldn't be loaded, so saving the params doesn't lose it
+	mLutFile = lutFile;
+	mLutDirty = true;
+	return * this;
+}
+
+vector<float> const & ColorCorrection::getLut() {
+	if (mLutDirty) {
+		mLut.resize(mLutSize * mLutSize * mLutSize * 3);
+		bakeColorCorrectionLut(mLut.data(), mLutSize, mBaseLut.empty() ? nullptr : mBaseLut.data(), mGamma, mWhitePoint);
+		mLutDirty = false;
+		mTexDirty = true;
+	}
+	return mLut;
+}
+
+gl::Texture3dRef ColorCorrection::getLutTexture() {
+	vector<float> const & lut = getLut();
+
+	if (!mLutTex || mLutTex->getWidth() != mLutSize) {
+		mLutTex = gl::Texture3d::create(mLutSize, mLutSize, mLutSize, gl::Texture3d::Format()
+			.internalFormat(GL_RGB16F)
+			.dataType(GL_FLOAT)
+			.minFilter(GL_LINEAR)
+			.magFilter(GL_LINEAR)
+			.wrap(GL_CLAMP_TO_EDGE));
+		mTexDirty = true;
+	}
+
+	if (mTexDirty) {
+		mLutTex->update(lut.data(), GL_RGB, GL_FLOAT, 0, mLutSize, mLutSize, mLutSize);
+		mTexDirty = false;
+	}
+
+	return mLutTex;
+}
+
+vector<float> loadCubeLut(DataSourceRef source, int * lutSize) {
+	std::istringstream lutStream(loadString(source));
+	vector<float> lut;
+	int size = 0;
+
+	string line;
+	while (std::getline(lutStream, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+
+		std::istringstream lineStream(line);
+		if (line.compare(0, 11, "LUT_3D_SIZE") == 0) {
+			string keyword;
+			if (!(lineStream >> keyword >> size) || size < MIN_CUBE_LUT_SIZE || size > MAX_CUBE_LUT_SIZE) {
+				std::cerr << "ERROR: invalid 3D LUT size: " << line << std::endl;
+				return vector<float>();
+			}
+			lut.reserve((size_t) size * size * size * 3);
+		} else if (isdigit(line[0]) || line[0] == '-' || line[0] == '.') {
+			float r, g, b;
+			if (lineStream >> r >> g >> b) {
+				lut.push_back(r);
+				lut.push_back(g);
+				lut.push_back(b);
+			}
+		}
+		// Everything else (TITLE, DOMAIN_MIN, DOMAIN_MAX, LUT_1D_SIZE) is ignored
+	}
+
+	if (size == 0) {
+		std::cerr << "ERROR: invalid 3D LUT, there's no LUT_3D_SIZE" << std::endl;
+		return vector<float>();
+	}
+	if (lut.size() != (size_t) size * size * size * 3) {
+		std::cerr << "ERROR: invalid 3D LUT, expected " << size << "^3 entries but found " << lut.size() / 3 << std::endl;
+		return vector<float>();
+	}
+
+	* lutSize = size;
+	return lut;
+}
+
+void bakeColorCorrectionLut(float * lut, int lutSize, float const * baseLut, vec3 gamma, Color whitePoint) {
+	float const scale = 1.0f / (float) (lutSize - 1);
+	float const channelScale[3] = { whitePoint.r, whitePoint.g, whitePoint.b };
+	float const channelGamma[3] = { gamma.x, gamma.y, gamma.z };
+
+	for (int b = 0; b < lutSize; b++) {
+		for (int g = 0; g < lutSize; g++) {
+			for (int r = 0; r < lutSize; r++) {
+				size_t entry = ((size_t) b * lutSize * lutSize + g * lutSize + r) * 3;
+				float const identity[3] = { r * scale, g * scale, b * scale };
+				float const * source = baseLut ? baseLut + entry : identity;
+
+				for (int c = 0; c < 3; c++) {
+					float value = std::min(std::max(source[c] * channelScale[c], 0.0f), 1.0f);
+					lut[entry + c] = std::pow(value, channelGamma[c]);
+				}
+			}
+		}
+	}
+}
+
+void applyColorLut(float const * lut, int lutSize, float const * rgb, float * result, size_t numPixels) {
+	// The shader maps [0, 1] onto the texel centers, so a color lands on lattice coordinate color * (lutSize - 1)
+	float const maxCoord = (float) (lutSize - 1);
+	int const maxCell = lutSize - 2;
+	size_t const rStep = 3;
+	size_t const gStep = (size_t) lutSize * 3;
+	size_t const bStep = gStep * lutSize;
+
+	// Pixels are done a block at a time. Working out the cells and weights is a branchless loop over the
+	// block that the compiler vectorises, and then the second loop fetches the corners and blends them.
+	size_t const BLOCK_SIZE = 64;
+	int cells[BLOCK_SIZE * 3];
+	float weights[BLOCK_SIZE * 3];
+
+	for (size_t blockStart = 0; blockStart < numPixels; blockStart += BLOCK_SIZE) {
+		size_t const numValues = std::min(BLOCK_SIZE, numPixels - blockStart) * 3;
+		float const * in = rgb + blockStart * 3;
+		float * out = result + blockStart * 3;
+
+		for (size_t i = 0; i < numValues; i++) {
+			// In this order a NaN ends up as 1, instead of an index outside the table
+			float coord = std::max(0.0f, std::min(1.0f, in[i])) * maxCoord;
+			int cell = std::min((int) coord, maxCell);
+			cells[i] = cell;
+			weights[i] = coord - (float) cell;
+		}
+
+		for (size_t i = 0; i < numValues; i += 3) {
+			float const * corner = lut + (cells[i + 2] * bStep + cells[i + 1] * gStep + cells[i] * rStep);
+			float const wr = weights[i];
+			float const wg = weights[i + 1];
+			float const wb = weights[i + 2];
+
+			for (int c = 0; c < 3; c++) {
+				float const * p = corner + c;
+				float r00 = p[0] + (p[rStep] - p[0]) * wr;
+				float r10 = p[gStep] + (p[gStep + rStep] - p[gStep]) * wr;
+				float r01 = p[bStep] + (p[bStep + rStep] - p[bStep]) * wr;
+				float r11 = p[bStep + gStep] + (p[bStep + gStep + rStep] - p[bStep + gStep]) * wr;
+				float g0 = r00 + (r10 - r00) * wg;
+				float g1 = r01 + (r11 - r01) * wg;
+				out[i + c] = g0 + (g1 - g0) * wb;
+			}
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cinder/Color.h"
+#include "cinder/DataSource.h"
+#include "cinder/gl/Texture.h"
+
+typedef std::shared_ptr<class ColorCorrection> ColorCorrectionRef;
+
+// Per-projector color correction, so that mismatched projectors can be made to agree where they overlap.
+// The white point and gamma are baked into a 3D lookup table (on top of an optional calibration LUT
+// loaded from a .cube file), which the projector shader samples as the very last step.
+class ColorCorrection {
+public:
+	static const int DEFAULT_LUT_SIZE = 17;
+
+	ColorCorrection();
+
+	ColorCorrection & setGamma(ci::vec3 gamma);
+	ColorCorrection & setWhitePoint(ci::Color whitePoint);
+	// An empty baseLut means the identity table is baked instead, e.g. when lutFile failed to load
+	ColorCorrection & setBaseLut(std::vector<float> baseLut, int lutSize, std::string lutFile);
+
+	ci::vec3 getGamma() const { return mGamma; }
+	ci::Color getWhitePoint() const { return mWhitePoint; }
+	std::string getLutFile() const { return mLutFile; }
+	int getLutSize() const { return mLutSize; }
+
+	// Both of these rebake the table if anything changed since the last call
+	std::vector<float> const & getLut();
+	ci::gl::Texture3dRef getLutTexture();
+
+private:
+	ci::vec3 mGamma;
+	ci::Color mWhitePoint;
+
+	std::string mLutFile;
+	int mLutSize;
+	std::vector<float> mBaseLut;
+
+	std::vector<float> mLut;
+	bool mLutDirty = true;
+	ci::gl::Texture3dRef mLutTex;
+	bool mTexDirty = true;
+};
+
+// Reads a LUT in the Adobe/Resolve .cube format. Returns an empty vector if the file isn't a valid 3D LUT.
+std::vector<float> loadCubeLut(ci::DataSourceRef source, int * lutSize);
+
+// Fills lut (lutSize^3 RGB triplets, red varying fastest) with baseLut (or the identity, if baseLut is null)
+// scaled by the white point and then raised to the per-channel gamma
+void bakeColorCorrectionLut(float * lut, int lutSize, float const * baseLut, ci::vec3 gamma, ci::Color whitePoint);
+
+// The CPU version of applyColorLut in colorLut_m.glsl: looks up numPixels interleaved RGB colors in lut (as
+// baked above), with the same clamping and trilinear filtering the texture lookup does. result can be rgb.
+void applyColorLut(float const * lut, int lutSize, float const * rgb, float * result, size_t numPixels);
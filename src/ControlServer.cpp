@@ -0,0 +1,333 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ControlServer.h"
+
+using namespace ci;
+using std::string;
+using std::vector;
+
+// Requests that arrive while this many are still waiting for the render thread get an error reply instead.
+// The outgoing queue is the same size, with anything that doesn't fit kept in a backlog on the render thread.
+static const size_t QUEUE_CAPACITY = 256;
+// Stats are dropped for clients that stop reading, rather than buffering forever
+static const size_t MAX_WRITE_BUFFER = 1 << 20;
+static const size_t MAX_LINE_LENGTH = 1 << 16;
+
+static void setNonBlocking(int fd) {
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+ControlServer::ControlServer(uint16_t port)
+: mPort(port), mRunning(false), mNumStatsSubscribers(0), mIncoming(QUEUE_CAPACITY), mOutgoing(QUEUE_CAPACITY) {}
+
+ControlServer::~ControlServer() {
+	stop();
+}
+
+bool ControlServer::start() {
+	mListenSocket = socket(AF_INET, SOCK_STREAM, 0);
+	if (mListenSocket < 0) {
+		std::cerr << "ERROR: could not create the control server socket: " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	int reuse = 1;
+	setsockopt(mListenSocket, SOL_SOCKET, SO_REUSEADDR, & reuse, sizeof(reuse));
+
+	sockaddr_in address;
+	memset(& address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(mPort);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (bind(mListenSocket, (sockaddr *) & address, sizeof(address)) < 0 || listen(mListenSocket, 8) < 0 || pipe(mWakePipe) < 0) {
+		std::cerr << "ERROR: could not start the control server on port " << mPort << ": " << strerror(errno) << std::endl;
+		stop();
+		return false;
+	}
+
+	setNonBlocking(mListenSocket);
+	setNonBlocking(mWakePipe[0]);
+	setNonBlocking(mWakePipe[1]);
+
+	mRunning = true;
+	mThread = std::thread([this] () { this->run(); });
+	std::cout << "control server listening on port " << mPort << std::endl;
+	return true;
+}
+
+void ControlServer::stop() {
+	if (mRunning.exchange(false)) {
+		wake();
+		mThread.join();
+	}
+	mOutgoingBacklog.clear();
+
+	for (auto & client : mClients) {
+		close(client.second.socket);
+	}
+	mClients.clear();
+
+	for (int * fd : { & mListenSocket, & mWakePipe[0], & mWakePipe[1] }) {
+		if (* fd >= 0) {
+			close(* fd);
+			* fd = -1;
+		}
+	}
+}
+
+bool ControlServer::popRequest(ControlMessage & request) {
+	flushOutgoingBacklog();
+	return mIncoming.pop(request);
+}
+
+void ControlServer::sendReply(int clientId, string body) {
+	queueOutgoing(ControlMessage(ControlMessage::REPLY, clientId, std::move(body)));
+}
+
+void ControlServer::setStatsSubscription(int clientId, bool subscribed) {
+	queueOutgoing(ControlMessage(subscribed ? ControlMessage::SUBSCRIBE_STATS : ControlMessage::UNSUBSCRIBE_STATS, clientId, ""));
+}
+
+void ControlServer::broadcastStats(string body) {
+	queueOutgoing(ControlMessage(ControlMessage::STATS, -1, std::move(body)));
+}
+
+void ControlServer::queueOutgoing(ControlMessage message) {
+	flushOutgoingBacklog();
+
+	if (message.kind == ControlMessage::STATS) {
+		// Stats are the only thing that can be dropped when the network thread falls behind, there'll be new ones next frame
+		if (mOutgoingBacklog.empty() && mOutgoing.push(std::move(message))) {
+			wake();
+		}
+		return;
+	}
+
+	// A lost reply would leave its client waiting forever, so replies (and subscription changes) wait in line instead
+	if (!mOutgoingBacklog.empty() || !mOutgoing.push(std::move(message))) {
+		mOutgoingBacklog.push_back(std::move(message));
+		return;
+	}
+	wake();
+}
+
+void ControlServer::flushOutgoingBacklog() {
+	bool pushedAny = false;
+	while (!mOutgoingBacklog.empty() && mOutgoing.push(std::move(mOutgoingBacklog.front()))) {
+		mOutgoingBacklog.pop_front();
+		pushedAny = true;
+	}
+	if (pushedAny) {
+		wake();
+	}
+}
+
+void ControlServer::wake() {
+	char wakeByte = 0;
+	(void) write(mWakePipe[1], & wakeByte, 1);
+}
+
+void ControlServer::run() {
+	vector<pollfd> pollList;
+	vector<int> pollClients;
+
+	while (mRunning) {
+		pollList.clear();
+		pollClients.clear();
+		pollList.push_back({ mListenSocket, POLLIN, 0 });
+		pollList.push_back({ mWakePipe[0], POLLIN, 0 });
+		for (auto & client : mClients) {
+			short events = (client.second.readClosed ? 0 : POLLIN) | (client.second.writeBuffer.empty() ? 0 : POLLOUT);
+			pollList.push_back({ client.second.socket, events, 0 });
+			pollClients.push_back(client.first);
+		}
+
+		if (poll(pollList.data(), pollList.size(), -1) < 0 && errno != EINTR) {
+			std::cerr << "ERROR: control server poll failed: " << strerror(errno) << std::endl;
+			break;
+		}
+
+		if (pollList[1].revents & POLLIN) {
+			char drain[64];
+			while (read(mWakePipe[0], drain, sizeof(drain)) > 0) {}
+		}
+		drainOutgoing();
+
+		if (pollList[0].revents & POLLIN) {
+			acceptClient();
+		}
+
+		for (size_t idx = 0; idx < pollClients.size(); idx++) {
+			short revents = pollList[idx + 2].revents;
+			auto client = mClients.find(pollClients[idx]);
+			if (client == mClients.end() || revents == 0) {
+				continue;
+			}
+
+			// A hangup after the client already stopped sending means it's gone completely
+			bool keepOpen = !(revents & (POLLERR | POLLNVAL)) && !(client->second.readClosed && (revents & POLLHUP));
+			if (keepOpen && !client->second.readClosed && (revents & (POLLIN | POLLHUP))) {
+				keepOpen = readClient(client->first, client->second);
+			}
+			if (keepOpen && (revents & POLLOUT)) {
+				keepOpen = writeClient(client->second);
+			}
+			if (!keepOpen) {
+				closeClient(client->first);
+			}
+		}
+
+		closeFinishedClients();
+	}
+}
+
+void ControlServer::acceptClient() {
+	int clientSocket;
+	while ((clientSocket = accept(mListenSocket, nullptr, nullptr)) >= 0) {
+		setNonBlocking(clientSocket);
+#ifdef SO_NOSIGPIPE
+		int noSigPipe = 1;
+		setsockopt(clientSocket, SOL_SOCKET, SO_NOSIGPIPE, & noSigPipe, sizeof(noSigPipe));
+#endif
+		Client client;
+		client.socket = clientSocket;
+		mClients[mNextClientId++] = client;
+	}
+}
+
+bool ControlServer::readClient(int clientId, Client & client) {
+	char buffer[4096];
+	ssize_t numRead;
+	while ((numRead = read(client.socket, buffer, sizeof(buffer))) > 0) {
+		client.readBuffer.append(buffer, numRead);
+	}
+	if (numRead < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+		return false;
+	}
+	// End of file: handle whatever complete lines were sent, then wait for their replies
+	client.readClosed = numRead == 0;
+
+	size_t lineEnd;
+	while ((lineEnd = client.readBuffer.find('\n')) != string::npos) {
+		string line = client.readBuffer.substr(0, lineEnd);
+		client.readBuffer.erase(0, lineEnd + 1);
+		if (line.empty()) {
+			continue;
+		}
+		if (mIncoming.push(ControlMessage(ControlMessage::REQUEST, clientId, line))) {
+			client.pendingReplies += 1;
+		} else {
+			client.writeBuffer += makeErrorReply(line, "too many pending requests") + "\n";
+		}
+	}
+
+	// Someone is sending garbage without newlines
+	return client.readBuffer.size() < MAX_LINE_LENGTH;
+}
+
+bool ControlServer::writeClient(Client & client) {
+	while (!client.writeBuffer.empty()) {
+#ifdef MSG_NOSIGNAL
+		ssize_t numWritten = send(client.socket, client.writeBuffer.data(), client.writeBuffer.size(), MSG_NOSIGNAL);
+#else
+		ssize_t numWritten = send(client.socket, client.writeBuffer.data(), client.writeBuffer.size(), 0);
+#endif
+		if (numWritten < 0) {
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		client.writeBuffer.erase(0, numWritten);
+	}
+	return true;
+}
+
+void ControlServer::drainOutgoing() {
+	ControlMessage message;
+	while (mOutgoing.pop(message)) {
+		if (message.kind == ControlMessage::STATS) {
+			for (auto & client : mClients) {
+				if (client.second.statsSubscriber && client.second.writeBuffer.size() < MAX_WRITE_BUFFER) {
+					client.second.writeBuffer += message.body + "\n";
+				}
+			}
+			continue;
+		}
+
+		// The client may have disconnected while the request was being handled
+		auto client = mClients.find(message.clientId);
+		if (client == mClients.end()) {
+			continue;
+		}
+
+		if (message.kind == ControlMessage::REPLY) {
+			client->second.writeBuffer += message.body + "\n";
+			client->second.pendingReplies -= 1;
+		} else if (message.kind == ControlMessage::SUBSCRIBE_STATS || message.kind == ControlMessage::UNSUBSCRIBE_STATS) {
+			bool subscribe = message.kind == ControlMessage::SUBSCRIBE_STATS;
+			if (client->second.statsSubscriber != subscribe) {
+				client->second.statsSubscriber = subscribe;
+				mNumStatsSubscribers += subscribe ? 1 : -1;
+			}
+		}
+	}
+
+	// Try to send right away, rather than waiting for the next poll
+	for (auto & client : mClients) {
+		if (!client.second.writeBuffer.empty()) {
+			writeClient(client.second);
+		}
+	}
+}
+
+void ControlServer::closeClient(int clientId) {
+	auto client = mClients.find(clientId);
+	if (client->second.statsSubscriber) {
+		mNumStatsSubscribers -= 1;
+	}
+	close(client->second.socket);
+	mClients.erase(client);
+}
+
+void ControlServer::closeFinishedClients() {
+	vector<int> finishedClients;
+	for (auto & client : mClients) {
+		if (client.second.readClosed && client.second.pendingReplies <= 0 && client.second.writeBuffer.empty()) {
+			finishedClients.push_back(client.first);
+		}
+	}
+	for (int clientId : finishedClients) {
+		closeClient(clientId);
+	}
+}
+
+string ControlServer::toMessageBody(JsonTree const & message) {
+	// The serializer pretty-prints, but newlines can only be whitespace (they're escaped inside strings)
+	string body = message.serialize();
+	std::replace(body.begin(), body.end(), '\n', ' ');
+	return body;
+}
+
+string ControlServer::makeErrorReply(string const & requestBody, string const & error) {
+	JsonTree reply = JsonTree::makeObject();
+	try {
+		JsonTree request(requestBody);
+		if (request.hasChild("id")) {
+			reply.addChild(request.getChild("id"));
+		}
+	} catch (std::exception const &) {
+		// Not even valid JSON, so there's no id to echo
+	}
+	reply.addChild(JsonTree("ok", false)).addChild(JsonTree("error", error));
+	return toMessageBody(reply);
+}
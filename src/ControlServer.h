@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "cinder/Json.h"
+
+#include "SpscQueue.h"
+
+typedef std::shared_ptr<class ControlServer> ControlServerRef;
+
+// A message to or from one connected client. Messages are single lines of JSON.
+struct ControlMessage {
+	enum Kind {
+		REQUEST,
+		REPLY,
+		STATS,
+		SUBSCRIBE_STATS,
+		UNSUBSCRIBE_STATS
+	};
+
+	ControlMessage() {}
+	ControlMessage(Kind _k, int _c, std::string _b) : kind(_k), clientId(_c), body(_b) {}
+
+	Kind kind = REQUEST;
+	int clientId = -1;
+	std::string body;
+};
+
+// Accepts TCP connections on the loopback interface, so projectors can be adjusted from another
+// machine through an ssh tunnel. The sockets are serviced on their own thread, and requests are handed
+// to the render thread (and replies handed back) through lock-free queues, so the render thread never
+// waits on the network.
+class ControlServer {
+public:
+	static ControlServerRef create(uint16_t port) { return ControlServerRef(new ControlServer(port)); }
+	~ControlServer();
+
+	bool start();
+	void stop();
+
+	// These are for the render thread only. popRequest() also retries any replies that didn't fit in the
+	// outgoing queue last time, so it should be called every frame.
+	bool popRequest(ControlMessage & request);
+	void sendReply(int clientId, std::string body);
+	void setStatsSubscription(int clientId, bool subscribed);
+	bool hasStatsSubscribers() const { return mNumStatsSubscribers.load(std::memory_order_relaxed) > 0; }
+	void broadcastStats(std::string body);
+
+	// Serializes a reply or stats message onto a single line
+	static std::string toMessageBody(ci::JsonTree const & message);
+	// An error reply that still echoes the request's "id", if the request is valid enough to have one
+	static std::string makeErrorReply(std::string const & requestBody, std::string const & error);
+
+private:
+	struct Client {
+		int socket;
+		std::string readBuffer;
+		std::string writeBuffer;
+		bool statsSubscriber = false;
+		// Requests handed to the render thread that haven't been replied to yet
+		int pendingReplies = 0;
+		// The client has shut down its sending side. It's only closed once all its replies are sent,
+		// so one-shot scripts (echo request | nc -N) still get their answers.
+		bool readClosed = false;
+	};
+
+	ControlServer(uint16_t port);
+
+	void run();
+	void acceptClient();
+	bool readClient(int clientId, Client & client);
+	bool writeClient(Client & client);
+	void queueOutgoing(ControlMessage message);
+	void flushOutgoingBacklog();
+	void wake();
+	void drainOutgoing();
+	void closeClient(int clientId);
+	void closeFinishedClients();
+
+	uint16_t mPort;
+	int mListenSocket = -1;
+	int mWakePipe[2] = { -1, -1 };
+	std::thread mThread;
+	std::atomic<bool> mRunning;
+
+	// Only touched by the network thread
+	std::map<int, Client> mClients;
+	int mNextClientId = 0;
+
+	std::atomic<int> mNumStatsSubscribers;
+	SpscQueue<ControlMessage> mIncoming;
+	SpscQueue<ControlMessage> mOutgoing;
+	// Replies and subscription changes that didn't fit in mOutgoing, oldest first. Only touched by the render thread.
+	std::deque<ControlMessage> mOutgoingBacklog;
+};
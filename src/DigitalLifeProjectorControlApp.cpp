@@ -1,6 +1,13 @@
 #include <memory>
 #include <map>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+#include "cinder/Thread.h"
 
 #include "Syphon.h"
 
@@ -10,6 +17,12 @@
 
 #include "WindowData.h"
 #include "ParamsControl.h"
+#include "ColorCorrection.h"
+#include "ControlServer.h"
+#include "SphereMesh.h"
+#include "Benchmark.h"
+#include "FileWatcher.h"
+#include "EventLog.h"
 
 using namespace ci;
 using namespace ci::app;
@@ -28,6 +41,23 @@ struct ProjectorUploadData {
 	float pad3;
 };
 
+// Shader programs by name, with their vertex, fragment and (optional) geometry shader files
+static const std::map<string, vector<string>> SHADER_SOURCES = {
+	{ "convertFrameToCubeMap", { "convertFrameToCubeMap_v.glsl", "convertFrameToCubeMap_f.glsl", "convertFrameToCubeMap_g.glsl" } },
+	{ "projectorCoverage", { "projectorCoverage_v.glsl", "projectorCoverage_f.glsl" } },
+	{ "syphonFrameAsCubeMapRender_projector", { "syphonFrameAsCubeMapRender_v.glsl", "syphonFrameAsCubeMapRender_f.glsl" } },
+	{ "syphonFrameAsCubeMapRender_external", { "syphonFrameAsCubeMapRender_v.glsl", "syphonFrameAsCubeMapRender_f.glsl" } }
+};
+
+// Everything rebuilt by the hot reload thread, waiting to be swapped in at the start of the next frame
+struct HotReload {
+	std::map<string, gl::GlslProgRef> shaders;
+	gl::VboMeshRef sphereMesh;
+	// Only the projectors whose entries in the params file changed
+	vector<Projector> projectors;
+	vector<ColorCorrectionRef> colorCorrections;
+};
+
 class DigitalLifeProjectorControlApp : public App {
 public:
 	// App functions
@@ -37,32 +67,71 @@ public:
 	void update() override;
 	void draw() override;
 	void keyDown(KeyEvent evt) override;
+	void cleanup() override;
 
 	// Drawing commands
 	void drawSphere(SphereRenderType sphereType);
+	void drawProjectorCoverage(vector<ProjectorRef> const & projectors);
 	void renderProjectorAlignmentView();
 
 	// Main params list function
 	void setupViewParams(params::InterfaceGlRef theParams);
 
 	// Window and projector data management and helpers
+	void editProjector(ProjectorRef projector, ProjectorField field, vec3 value);
 	void createNewWindow();
 	void closeThisWindow();
 	ProjectorRef getProjectorForWindow(int windowId);
 	vector<SubWindowData *> getSubWindowDataVec();
+	vector<ProjectorRef> getActiveProjectors();
 
 	// Syphon stuff
 	void setupSyphonCxn(std::vector<ciSyphon::ServerDescription> announcedServerList);
 
+	// Remote control
+	void processControlRequests();
+	JsonTree handleControlRequest(int clientId, JsonTree const & request);
+	void sendFrameStats(double updateStartTime);
+
+	// Run with --benchmark [output.json] [--baseline baseline.json] [--tolerance 0.1]
+	int runBenchmarks(fs::path outputFile, fs::path baselineFile, double tolerance);
+
+	// Shaders and hot reloading
+	gl::GlslProgRef buildShader(string name);
+	void setShader(string name, gl::GlslProgRef shader);
+	void trackAsset(string artifact, vector<fs::path> files);
+	void trackShaderDependencies(string name);
+	void hotReloadThreadFn(gl::ContextRef backgroundContext);
+	void rebuildChangedAssets(vector<fs::path> const & changedFiles);
+	void applyHotReload();
+	void saveParams();
+
 	int mNumWindowsCreated = 0;
 	uint32_t mDestinationCubeMapSide = 1600;
 	string mParamsFile = "projectorControlParams.json";
+	string mSphereMeshFile = "sphere_scan_2017_03_02/sphere_scan_2017_03_02_edited.obj";
+	string mEventLogFile = "calibrationEvents.log";
+	uint16_t mControlPort = 9100;
 
 	// Params and windows management
 	JsonTree mParamsTree;
 	vector<ProjectorRef> mProjectorParams;
+	std::map<int, ColorCorrectionRef> mColorCorrections;
 	std::map<int, int> mProjectorWindowMap;
 	params::InterfaceGlRef mMenu;
+	ControlServerRef mControlServer;
+	double mLastFrameTime = 0.0;
+	EventRecorderRef mEventRecorder;
+
+	// Hot reloading. The watcher and dependencies are only used by the reload thread once it starts.
+	FileWatcher mFileWatcher;
+	AssetDependencies mAssetDependencies;
+	// What's in the params file for each projector, as last loaded or saved. Guarded by mHotReloadMutex.
+	std::map<int, string> mLoadedProjectorParams;
+	std::thread mHotReloadThread;
+	std::atomic<bool> mHotReloadRunning { false };
+	std::mutex mHotReloadMutex;
+	HotReload mPendingReload;
 
 	// Main window render stuff
 	SphereRenderType mSphereRenderType = SphereRenderType::TEXTURE;
@@ -92,14 +161,35 @@ void DigitalLifeProjectorControlApp::prepSettings(Settings * settings) {
 }
 
 void DigitalLifeProjectorControlApp::setup() {
+	auto const & args = getCommandLineArgs();
+	auto argValue = [&args] (vector<string>::const_iterator flag, string defaultValue) {
+		return (flag != args.end() && flag + 1 != args.end() && (flag + 1)->compare(0, 2, "--") != 0) ? * (flag + 1) : defaultValue;
+	};
+	// Apps launched from the Finder run in /, so relative paths are put next to the app instead
+	auto resolvePath = [this] (fs::path file) {
+		return file.is_relative() ? getAppPath() / file : file;
+	};
+
+	// --replay [calibrationEvents.log] [output.json] doesn't need any of the setup below.
+	// (ReplayEvents does the same without the app, so it doesn't even open the main window.)
+	auto replayArg = std::find(args.begin(), args.end(), "--replay");
+	if (replayArg != args.end()) {
+		fs::path logFile = resolvePath(argValue(replayArg, mEventLogFile));
+		fs::path outputFile = resolvePath(argValue(replayArg + 1, "replayedParams.json"));
+		// LUT files are looked up next to the params file, like parseColorCorrection does
+		std::exit(replayEventLog(logFile, outputFile, getAssetPath(mParamsFile).parent_path()));
+	}
+
 	getWindow()->setUserData<MainWindowData>(new MainWindowData());
 
 	mParamsTree = loadProjectorParams(this, mParamsFile);
 
 	for (int projIdx = 0; projIdx < mParamsTree.getNumChildren(); projIdx++) {
 		mProjectorParams.push_back(ProjectorRef(new Projector(parseProjectorParams(mParamsTree.getChild(projIdx)))));
+		mColorCorrections[mProjectorParams.back()->getId()] = parseColorCorrection(this, mParamsTree.getChild(projIdx));
 		// Put the projector ID into the projector-window map without a window assigned
 		mProjectorWindowMap[mProjectorParams.back()->getId()] = -1;
+		mLoadedProjectorParams[mProjectorParams.back()->getId()] = mParamsTree.getChild(projIdx).serialize();
 	}
 
 	mMenu = params::InterfaceGl::create(getWindow(), "Params", toPixels(ivec2(400, getWindowHeight() - 40)));
@@ -110,6 +200,34 @@ void DigitalLifeProjectorControlApp::setup() {
 	mCamera.lookAt(vec3(0, 0, 4), vec3(0), vec3(0, 1, 0));
 	mCameraUi = CameraUi(& mCamera, getWindow());
 
+	mFrameDestinationCubeMap = FboCubeMapLayered::create(mDestinationCubeMapSide, mDestinationCubeMapSide, FboCubeMapLayered::Format().depth(false));
+	mFrameToCubeMapConvertMesh = makeRowLayoutToCubeMapMesh(mDestinationCubeMapSide);
+
+	// Set up the sphere mesh projection target
+	mScanSphereMesh = gl::VboMesh::create(loadSphereMesh(loadAsset(mSphereMeshFile)));
+	mScanSphereTexture = gl::Texture::create(loadImage(loadAsset("sphere_scan_2017_03_02/sphere_scan_2017_03_02.png")));
+
+	for (auto & shader : SHADER_SOURCES) {
+		setShader(shader.first, buildShader(shader.first));
+		trackShaderDependencies(shader.first);
+	}
+	trackAsset("sphereMesh", { getAssetPath(mSphereMeshFile) });
+	trackAsset("params", { getAssetPath(mParamsFile) });
+
+	// The benchmark needs the shaders and meshes, but it exits before the control server, Syphon, the reload
+	// thread and the event log are started, so it can run next to a live instance
+	auto benchmarkArg = std::find(args.begin(), args.end(), "--benchmark");
+	if (benchmarkArg != args.end()) {
+		fs::path outputFile = resolvePath(argValue(benchmarkArg, "benchmark.json"));
+		string baselineFile = argValue(std::find(args.begin(), args.end(), "--baseline"), "");
+		double tolerance = std::stod(argValue(std::find(args.begin(), args.end(), "--tolerance"), "0.1"));
+
+		std::exit(runBenchmarks(outputFile, baselineFile.empty() ? fs::path() : resolvePath(baselineFile), tolerance));
+	}
+
+	mControlServer = ControlServer::create(mControlPort);
+	mControlServer->start();
+
 	// TODO: Figure out why connecting to the server after this event's been fired doesn't work, and fix it (see also setupSyphonCxn)
 	// mSyphonServerDir.setup();
 	// mSyphonServerDir.getServerAnnouncedSignal()->connect([this] (vector<ciSyphon::ServerDescription> servers) { this->setupSyphonCxn(servers); });
@@ -118,41 +236,17 @@ void DigitalLifeProjectorControlApp::setup() {
 	mSyphonClient->set("DigitalLifeServer", "DigitalLifeClient"); // Just in case the server is already there
 	mSyphonClient->setup();
 
-	mFrameDestinationCubeMap = FboCubeMapLayered::create(mDestinationCubeMapSide, mDestinationCubeMapSide, FboCubeMapLayered::Format().depth(false));
-	mFrameToCubeMapConvertMesh = makeRowLayoutToCubeMapMesh(mDestinationCubeMapSide);
-	mFrameToCubeMapConvertShader = gl::GlslProg::create(loadAsset("convertFrameToCubeMap_v.glsl"), loadAsset("convertFrameToCubeMap_f.glsl"), loadAsset("convertFrameToCubeMap_g.glsl"));
-	mFrameToCubeMapConvertBatch = gl::Batch::create(mFrameToCubeMapConvertMesh, mFrameToCubeMapConvertShader, { { geom::CUSTOM_0, "faceIndex" } });
-
-	// Set up the sphere mesh projection target
-	ObjLoader meshLoader(loadAsset("sphere_scan_2017_03_02/sphere_scan_2017_03_02_edited.obj"));
-	TriMesh sphereMesh(meshLoader, TriMesh::Format().positions().normals().texCoords0(2).texCoords1(3));
-
-	// Do some fancy stuff to set up the mesh's 3D texture coordinates
-	// TODO: do this in a script and bake these coordinates into the mesh
-	sphereMesh.getBufferTexCoords1().resize(sphereMesh.getNumVertices() * 3); // 3-dimensional tex coord
-
-	vec3 MAGIC_SPHERE_ORIGIN(0.00582, 0.31940, -0.01190); // I know this because of magic
+	// The reload thread gets its own GL context, shared with the windows' contexts, so it can compile shaders
+	// and upload meshes without stalling the render
+	mHotReloadRunning = true;
+	mHotReloadThread = std::thread(std::bind(& DigitalLifeProjectorControlApp::hotReloadThreadFn, this, gl::Context::create(gl::context())));
 
-	vec3 const * positions = sphereMesh.getPositions<3>();
-	vec3 * cubeMapTexCoords = sphereMesh.getTexCoords1<3>();
-	for (size_t idx = 0; idx < sphereMesh.getNumVertices(); idx++) {
-		cubeMapTexCoords[idx] = normalize(positions[idx] - MAGIC_SPHERE_ORIGIN);
+	mEventRecorder = EventRecorder::create(getAppPath() / mEventLogFile);
+	// Start each session from a snapshot of the params it loaded, so replays don't need the params file
+	mEventRecorder->record(EventType::SESSION_START, 0);
+	for (auto & proj : mProjectorParams) {
+		mEventRecorder->recordProjectorSnapshot(* proj, * mColorCorrections[proj->getId()]);
 	}
-
-	mScanSphereMesh = gl::VboMesh::create(sphereMesh);
-	mScanSphereTexture = gl::Texture::create(loadImage(loadAsset("sphere_scan_2017_03_02/sphere_scan_2017_03_02.png")));
-
-	mProjectorCoverageShader = gl::GlslProg::create(loadAsset("projectorCoverage_v.glsl"), loadAsset("projectorCoverage_f.glsl"));
-	auto syphonFrameOnModel_v = loadAsset("syphonFrameAsCubeMapRender_v.glsl");
-	auto syphonFrameOnModel_f = loadAsset("syphonFrameAsCubeMapRender_f.glsl");
-	mSyphonFrameAsCubeMapRenderShader_projector = gl::GlslProg::create(
-		gl::GlslProg::Format()
-			.vertex(syphonFrameOnModel_v).fragment(syphonFrameOnModel_f)
-	);
-	mSyphonFrameAsCubeMapRenderShader_external = gl::GlslProg::create(
-		gl::GlslProg::Format()
-			.vertex(syphonFrameOnModel_v).fragment(syphonFrameOnModel_f).define("EXTERNAL_VIEW")
-	);
 }
 
 void DigitalLifeProjectorControlApp::setupSyphonCxn(std::vector<ciSyphon::ServerDescription> announcedServerList) {
@@ -167,6 +261,8 @@ void DigitalLifeProjectorControlApp::setupSyphonCxn(std::vector<ciSyphon::Server
 }
 
 void DigitalLifeProjectorControlApp::keyDown(KeyEvent evt) {
+	mEventRecorder->record(EventType::KEY_COMMAND, evt.getCode(), evt.getChar());
+
 	if (evt.getCode() == KeyEvent::KEY_ESCAPE) {
 		quit();
 	} else if (evt.getCode() == KeyEvent::KEY_n) {
@@ -178,7 +274,7 @@ void DigitalLifeProjectorControlApp::keyDown(KeyEvent evt) {
 	} else if (evt.getCode() == KeyEvent::KEY_m) {
 		mMenu->show(!mMenu->isVisible());
 	} else if (evt.getCode() == KeyEvent::KEY_s) {
-		saveProjectorParams(this, mProjectorParams, mParamsFile);
+		saveParams();
 	} else if (evt.isAltDown() && evt.isMetaDown() && evt.getChar() >= '0' && evt.getChar() <= '9') {
 		size_t displayNum = evt.getChar() - '0';
 		auto displayList = Display::getDisplays();
@@ -193,6 +289,15 @@ void DigitalLifeProjectorControlApp::keyDown(KeyEvent evt) {
 	}
 }
 
+void DigitalLifeProjectorControlApp::cleanup() {
+	mControlServer->stop();
+
+	mHotReloadRunning = false;
+	if (mHotReloadThread.joinable()) {
+		mHotReloadThread.join();
+	}
+}
+
 ProjectorRef DigitalLifeProjectorControlApp::getProjectorForWindow(int windowId) {
 	// Find the first projector ID that matches the provided window id
 	auto projMapPosition = std::find_if(mProjectorWindowMap.begin(), mProjectorWindowMap.end(), [=] (std::pair<int, int> const & element) { return element.second == windowId; });
@@ -201,6 +306,14 @@ ProjectorRef DigitalLifeProjectorControlApp::getProjectorForWindow(int windowId)
 	return * projVecPosition;
 }
 
+vector<ProjectorRef> DigitalLifeProjectorControlApp::getActiveProjectors() {
+	vector<ProjectorRef> projectors;
+	for (auto winData : getSubWindowDataVec()) {
+		projectors.push_back(winData->mProjector);
+	}
+	return projectors;
+}
+
 vector<SubWindowData *> DigitalLifeProjectorControlApp::getSubWindowDataVec() {
 	vector<SubWindowData *> dataVec;
 	for (int winIdx = 1; winIdx < getNumWindows(); winIdx++) {
@@ -210,6 +323,11 @@ vector<SubWindowData *> DigitalLifeProjectorControlApp::getSubWindowDataVec() {
 	return std::move(dataVec);
 }
 
+void DigitalLifeProjectorControlApp::editProjector(ProjectorRef projector, ProjectorField field, vec3 value) {
+	applyProjectorField(* projector, * mColorCorrections[projector->getId()], field, value);
+	mEventRecorder->recordProjectorField(projector->getId(), field, value);
+}
+
 void DigitalLifeProjectorControlApp::createNewWindow() {
 	ProjectorRef newWindowProj;
 	if (mProjectorWindowMap.size() > getNumWindows() - 1) { // Subtract 1 for the main window
@@ -227,7 +345,12 @@ void DigitalLifeProjectorControlApp::createNewWindow() {
 
 		// Add the projector to the app's stored data
 		mProjectorParams.push_back(newWindowProj);
+		mColorCorrections[newWindowProj->getId()] = std::make_shared<ColorCorrection>();
 	}
+	mEventRecorder->record(EventType::WINDOW_CREATED, mNumWindowsCreated, newWindowProj->getId());
+	// Includes the random values, if the projector is new
+	mEventRecorder->recordProjectorSnapshot(* newWindowProj, * mColorCorrections[newWindowProj->getId()]);
+
 	// mNumWindowsCreated is the window unique ID. It always increases, unlike getNumWindows()
 	mProjectorWindowMap[newWindowProj->getId()] = mNumWindowsCreated;
 	app::WindowRef newWindow = createWindow(Window::Format());
@@ -247,6 +370,7 @@ void DigitalLifeProjectorControlApp::closeThisWindow() {
 		// The only way to delete a projector once it's been saved to the params file is to manually edit the params file
 		SubWindowData * windowUserData = theWindow->getUserData<SubWindowData>();
 
+		mEventRecorder->record(EventType::WINDOW_CLOSED, windowUserData->mId, windowUserData->mProjector->getId());
 		mProjectorWindowMap[windowUserData->mProjector->getId()] = -1;
 
 		theWindow->close();
@@ -255,30 +379,41 @@ void DigitalLifeProjectorControlApp::closeThisWindow() {
 	}
 }
 
-void DigitalLifeProjectorControlApp::update()
-{
-	mLatestFrame = mSyphonClient->fetchFrame();
+// Render the (row layout) frame onto a cubemap
+void renderFrameToCubeMap(gl::TextureRef frame, FboCubeMapLayeredRef cubeMap, gl::BatchRef convertBatch) {
+	gl::ScopedFramebuffer scpFbo(GL_FRAMEBUFFER, cubeMap->getId());
 
-	// Render the frame onto a cubemap
-	{	
-		gl::ScopedFramebuffer scpFbo(GL_FRAMEBUFFER, mFrameDestinationCubeMap->getId());
+	gl::ScopedFaceCulling scpCull(false);
 
-		gl::ScopedFaceCulling scpCull(false);
+	gl::ScopedViewport scpView(0, 0, cubeMap->getWidth(), cubeMap->getHeight());
 
-		gl::ScopedViewport scpView(0, 0, mFrameDestinationCubeMap->getWidth(), mFrameDestinationCubeMap->getHeight());
+	gl::ScopedMatrices scpMat;
+	// TODO: I'm not actually sure why I need to switch the y-axis here? But it does need to happen to get the tex coords right
+	gl::setMatricesWindow(cubeMap->getWidth(), cubeMap->getHeight(), false);
 
-		gl::ScopedMatrices scpMat;
-		// TODO: I'm not actually sure why I need to switch the y-axis here? But it does need to happen to get the tex coords right
-		gl::setMatricesWindow(mFrameDestinationCubeMap->getWidth(), mFrameDestinationCubeMap->getHeight(), false);
+	gl::clear(Color(0, 0, 0));
 
-		gl::clear(Color(0, 0, 0));
+	gl::ScopedTextureBind scpTex(frame, 0);
+	convertBatch->getGlslProg()->uniform("uSourceTex", 0);
+	convertBatch->getGlslProg()->uniform("uSourceTexDims", vec2(frame->getWidth(), frame->getHeight()));
 
-		gl::ScopedTextureBind scpTex(mLatestFrame, 0);
-		mFrameToCubeMapConvertShader->uniform("uSourceTex", 0);
-		mFrameToCubeMapConvertShader->uniform("uSourceTexDims", vec2(mLatestFrame->getWidth(), mLatestFrame->getHeight()));
+	convertBatch->draw();
+}
 
-		mFrameToCubeMapConvertBatch->draw();
-	}
+void DigitalLifeProjectorControlApp::update()
+{
+	double updateStartTime = getElapsedSeconds();
+
+	applyHotReload();
+
+	// Apply remote changes at the start of the frame, so every window renders the same state
+	processControlRequests();
+
+	mLatestFrame = mSyphonClient->fetchFrame();
+
+	renderFrameToCubeMap(mLatestFrame, mFrameDestinationCubeMap, mFrameToCubeMapConvertBatch);
+
+	sendFrameStats(updateStartTime);
 }
 
 void DigitalLifeProjectorControlApp::draw()
@@ -347,6 +482,25 @@ void DigitalLifeProjectorControlApp::draw()
 	}
 }
 
+gl::UboRef makeProjectorsUbo(vector<ProjectorRef> const & projectors) {
+	vector<ProjectorUploadData> projectorList;
+	for (auto & proj : projectors) {
+		projectorList.emplace_back(proj->getWorldPos(), proj->getTarget(), proj->getColor());
+	}
+	return gl::Ubo::create(sizeof(ProjectorUploadData) * projectorList.size(), projectorList.data());
+}
+
+void DigitalLifeProjectorControlApp::drawProjectorCoverage(vector<ProjectorRef> const & projectors) {
+	gl::UboRef projectorsUbo = makeProjectorsUbo(projectors);
+
+	projectorsUbo->bindBufferBase(0);
+	mProjectorCoverageShader->uniformBlock("uProjectors", 0);
+	mProjectorCoverageShader->uniform("uNumProjectors", (int) projectors.size());
+
+	gl::ScopedGlslProg scpShader(mProjectorCoverageShader);
+	gl::draw(mScanSphereMesh);
+}
+
 void DigitalLifeProjectorControlApp::drawSphere(SphereRenderType sphereType) {
 	// Draw the sphere itself
 	if (sphereType == SphereRenderType::WIREFRAME) {
@@ -358,29 +512,15 @@ void DigitalLifeProjectorControlApp::drawSphere(SphereRenderType sphereType) {
 		gl::ScopedTextureBind scpTex(mScanSphereTexture);
 		gl::draw(mScanSphereMesh);
 	} else if (sphereType == SphereRenderType::PROJECTOR_COVERAGE) {
-		vector<ProjectorUploadData> projectorList;
-		for (auto winData : getSubWindowDataVec()) {
-			projectorList.emplace_back(winData->mProjector->getWorldPos(), winData->mProjector->getTarget(), winData->mProjector->getColor());
-		}
-		gl::UboRef projectorsUbo = gl::Ubo::create(sizeof(ProjectorUploadData) * projectorList.size(), projectorList.data());
-
-		projectorsUbo->bindBufferBase(0);
-		mProjectorCoverageShader->uniformBlock("uProjectors", 0);
-		mProjectorCoverageShader->uniform("uNumProjectors", (int) projectorList.size());
-
-		gl::ScopedGlslProg scpShader(mProjectorCoverageShader);
-		gl::draw(mScanSphereMesh);
+		drawProjectorCoverage(getActiveProjectors());
 	} else if (sphereType == SphereRenderType::SYPHON_FRAME) {
 		if (getWindow()->getUserData<BaseWindowData>()->isMainWindow()) {
-			vector<ProjectorUploadData> projectorList;
-			for (auto winData : getSubWindowDataVec()) {
-				projectorList.emplace_back(winData->mProjector->getWorldPos(), winData->mProjector->getTarget(), winData->mProjector->getColor());
-			}
-			gl::UboRef projectorsUbo = gl::Ubo::create(sizeof(ProjectorUploadData) * projectorList.size(), projectorList.data());
+			vector<ProjectorRef> projectors = getActiveProjectors();
+			gl::UboRef projectorsUbo = makeProjectorsUbo(projectors);
 
 			projectorsUbo->bindBufferBase(0);
 			mSyphonFrameAsCubeMapRenderShader_external->uniformBlock("uProjectors", 0);
-			mSyphonFrameAsCubeMapRenderShader_external->uniform("uNumProjectors", (int) projectorList.size());
+			mSyphonFrameAsCubeMapRenderShader_external->uniform("uNumProjectors", (int) projectors.size());
 
 			gl::ScopedGlslProg scpShader(mSyphonFrameAsCubeMapRenderShader_external);
 
@@ -389,10 +529,16 @@ void DigitalLifeProjectorControlApp::drawSphere(SphereRenderType sphereType) {
 
 			gl::draw(mScanSphereMesh);
 		} else {
+			ProjectorRef windowProjector = getWindow()->getUserData<SubWindowData>()->mProjector;
+			ColorCorrectionRef colorCorrection = mColorCorrections[windowProjector->getId()];
+
 			gl::ScopedGlslProg scpShader(mSyphonFrameAsCubeMapRenderShader_projector);
 			mSyphonFrameAsCubeMapRenderShader_projector->uniform("uCubeMapTex", 0);
-			mSyphonFrameAsCubeMapRenderShader_projector->uniform("uProjectorPos", getWindow()->getUserData<SubWindowData>()->mProjector->getWorldPos());
+			mSyphonFrameAsCubeMapRenderShader_projector->uniform("uProjectorPos", windowProjector->getWorldPos());
+			mSyphonFrameAsCubeMapRenderShader_projector->uniform("uColorLut", 1);
+			mSyphonFrameAsCubeMapRenderShader_projector->uniform("uColorLutSize", (float) colorCorrection->getLutSize());
 			gl::ScopedTextureBind scpTex(mFrameDestinationCubeMap->getColorTex(), 0);
+			gl::ScopedTextureBind scpLut(colorCorrection->getLutTexture(), 1);
 			gl::draw(mScanSphereMesh);
 		}
 	}
@@ -485,6 +631,7 @@ void DigitalLifeProjectorControlApp::setupViewParams(params::InterfaceGlRef theP
 		"Projector Coverage",
 		"Syphon Frame"
 	}, [this] (int renderMode) {
+		mEventRecorder->record(EventType::RENDER_MODE, -1, renderMode);
 		switch (renderMode) {
 			case 0: mSphereRenderType = SphereRenderType::WIREFRAME; break;
 			case 1: mSphereRenderType = SphereRenderType::TEXTURE; break;
@@ -508,6 +655,7 @@ void DigitalLifeProjectorControlApp::setupViewParams(params::InterfaceGlRef theP
 		// (I also hope InterfaceGl::clear() is smart enough to destroy all attached function objects)
 		// (I'm pretty sure both are the case)
 		ProjectorRef theProjector = getProjectorForWindow(windowData->mId);
+		ColorCorrectionRef theCorrection = mColorCorrections[theProjector->getId()];
 
 		// Just a lil sanity check
 		assert(theProjector == windowData->mProjector);
@@ -524,7 +672,8 @@ void DigitalLifeProjectorControlApp::setupViewParams(params::InterfaceGlRef theP
 			"Projector Coverage",
 			"Syphon Frame",
 			"Projector Alignment"
-		}, [windowData] (int renderMode) {
+		}, [this, windowData] (int renderMode) {
+			mEventRecorder->record(EventType::RENDER_MODE, windowData->mProjector->getId(), renderMode);
 			if (renderMode == 4) {
 				windowData->mRenderArrow = true;
 			} else {
@@ -551,53 +700,402 @@ void DigitalLifeProjectorControlApp::setupViewParams(params::InterfaceGlRef theP
 		// Dividing by 10 makes the positioning more precise by that factor
 		// (precision and step functions don't work for this control)
 		theParams->addParam<vec3>(pname + " Position",
-			[theProjector] (vec3 projPos) {
-				theProjector->moveTo(projPos / 10.0f);
+			[this, theProjector] (vec3 projPos) {
+				editProjector(theProjector, ProjectorField::POSITION, projPos / 10.0f);
 			}, [theProjector] () {
 				return theProjector->getPos() * 10.0f;
 			});
 
 		theParams->addParam<bool>(pname + " Flipped",
-			[theProjector] (bool isFlipped) {
-				theProjector->setUpsideDown(isFlipped);
+			[this, theProjector] (bool isFlipped) {
+				editProjector(theProjector, ProjectorField::UPSIDE_DOWN, vec3(isFlipped ? 1.0f : 0.0f));
 			}, [theProjector] () {
 				return theProjector->getUpsideDown();
 			});
 
 		theParams->addParam<float>(pname + " Y Rotation",
-			[theProjector] (float rotation) {
-				theProjector->setYRotation(rotation);
+			[this, theProjector] (float rotation) {
+				editProjector(theProjector, ProjectorField::Y_ROTATION, vec3(rotation));
 			}, [theProjector] () {
 				return theProjector->getYRotation();
 			}).min(-M_PI / 2).max(M_PI / 2).precision(4).step(0.0002f);
 
 		theParams->addParam<float>(pname + " Horizontal FoV",
-			[theProjector] (float fov) {
-				theProjector->setHorFOV(fov);
+			[this, theProjector] (float fov) {
+				editProjector(theProjector, ProjectorField::HOR_FOV, vec3(fov));
 			}, [theProjector] () {
 				return theProjector->getHorFOV();
 			}).min(M_PI / 16.0f).max(M_PI * 3.0 / 4.0).precision(4).step(0.001f);
 
 		theParams->addParam<float>(pname + " Vertical FoV",
-			[theProjector] (float fov) {
-				theProjector->setVertFOV(fov);
+			[this, theProjector] (float fov) {
+				editProjector(theProjector, ProjectorField::VERT_FOV, vec3(fov));
 			}, [theProjector] () {
 				return theProjector->getVertFOV();
 			}).min(M_PI / 16.0f).max(M_PI * 3.0 / 4.0).precision(4).step(0.001f);
 
 		theParams->addParam<float>(pname + " Vertical Offset Angle",
-			[theProjector] (float angle) {
-				theProjector->setVertBaseAngle(angle);
+			[this, theProjector] (float angle) {
+				editProjector(theProjector, ProjectorField::BASE_ANGLE, vec3(angle));
 			}, [theProjector] () {
 				return theProjector->getVertBaseAngle();
 			}).min(0.0f).max(M_PI / 2.0f).precision(4).step(0.001f);
 
 		theParams->addParam<Color>(pname + " Color",
-			[theProjector] (Color color) {
-				theProjector->setColor(color);
+			[this, theProjector] (Color color) {
+				editProjector(theProjector, ProjectorField::COLOR, vec3(color.r, color.g, color.b));
 			}, [theProjector] () {
 				return theProjector->getColor();
 			});
+
+		// Color correction is only visible in the "Syphon Frame" render mode of the projector windows
+		theParams->addParam<Color>(pname + " White Point",
+			[this, theProjector] (Color whitePoint) {
+				editProjector(theProjector, ProjectorField::WHITE_POINT, vec3(whitePoint.r, whitePoint.g, whitePoint.b));
+			}, [theCorrection] () {
+				return theCorrection->getWhitePoint();
+			});
+
+		string const channelNames[3] = { "Red", "Green", "Blue" };
+		for (int channel = 0; channel < 3; channel++) {
+			theParams->addParam<float>(pname + " " + channelNames[channel] + " Gamma",
+				[this, theProjector, theCorrection, channel] (float gamma) {
+					vec3 allGamma = theCorrection->getGamma();
+					allGamma[channel] = gamma;
+					editProjector(theProjector, ProjectorField::GAMMA, allGamma);
+				}, [theCorrection, channel] () {
+					return theCorrection->getGamma()[channel];
+				}).min(0.1f).max(4.0f).precision(3).step(0.01f);
+		}
+	}
+}
+
+// Remote control protocol: one JSON object per line in each direction, for example
+//   {"cmd": "set", "projector": 1, "params": {"yRotation": 0.01}}
+// Every reply has an "ok" key, and echoes the request's "id" key (if it has one) so clients can match them up
+void DigitalLifeProjectorControlApp::processControlRequests() {
+	ControlMessage request;
+	while (mControlServer->popRequest(request)) {
+		string replyBody;
+		try {
+			replyBody = ControlServer::toMessageBody(handleControlRequest(request.clientId, JsonTree(request.body)));
+		} catch (std::exception const & exc) {
+			replyBody = ControlServer::makeErrorReply(request.body, exc.what());
+		}
+		mControlServer->sendReply(request.clientId, replyBody);
+	}
+}
+
+// Overwrites the children of base with any matching children from changes
+JsonTree mergeJson(JsonTree const & base, JsonTree const & changes) {
+	JsonTree merged = JsonTree::makeObject(base.getKey());
+	for (auto const & child : base) {
+		merged.addChild(changes.hasChild(child.getKey()) ? changes.getChild(child.getKey()) : child);
+	}
+	return merged;
+}
+
+JsonTree DigitalLifeProjectorControlApp::handleControlRequest(int clientId, JsonTree const & request) {
+	string command = request.getValueForKey("cmd");
+	JsonTree reply = JsonTree::makeObject();
+	if (request.hasChild("id")) {
+		reply.addChild(request.getChild("id"));
+	}
+
+	auto error = [&reply] (string message) {
+		return reply.addChild(JsonTree("ok", false)).addChild(JsonTree("error", message));
+	};
+
+	ProjectorRef projector;
+	if (request.hasChild("projector")) {
+		int projectorId = request.getValueForKey<int>("projector");
+		auto projVecPosition = std::find_if(mProjectorParams.begin(), mProjectorParams.end(), [=] (ProjectorRef const & proj) { return proj->getId() == projectorId; });
+		if (projVecPosition == mProjectorParams.end()) {
+			return error("no projector with id " + std::to_string(projectorId));
+		}
+		projector = * projVecPosition;
+	}
+
+	if (command == "list") {
+		JsonTree projectorList = JsonTree::makeArray("projectors");
+		for (auto & proj : mProjectorParams) {
+			projectorList.addChild(JsonTree::makeObject()
+				.addChild(JsonTree("id", proj->getId()))
+				.addChild(JsonTree("window", mProjectorWindowMap[proj->getId()])));
+		}
+		reply.addChild(projectorList);
+	} else if (command == "get") {
+		if (!projector) { return error("get needs a projector"); }
+		// serializeProjector's tree has no key, so its fields are copied straight into "params"
+		JsonTree projParams = JsonTree::makeObject("params");
+		for (auto const & field : serializeProjector(* projector)) {
+			projParams.addChild(field);
+		}
+		projParams.addChild(serializeColorCorrection(* mColorCorrections[projector->getId()]));
+		reply.addChild(projParams);
+	} else if (command == "set") {
+		if (!projector) { return error("set needs a projector"); }
+		JsonTree const & changes = request.getChild("params");
+
+		// Parse everything before changing anything, so a bad value doesn't leave the projector half-updated
+		Projector updated = parseProjectorParams(mergeJson(serializeProjector(* projector), changes));
+		updated.setId(projector->getId());
+
+		ColorCorrectionRef correction = mColorCorrections[projector->getId()];
+		if (changes.hasChild("colorCorrection")) {
+			JsonTree mergedCorrection = mergeJson(serializeColorCorrection(* correction), changes.getChild("colorCorrection"));
+			// Copy into the existing object, since the params menu holds on to it
+			* correction = * parseColorCorrection(this, JsonTree::makeObject().addChild(mergedCorrection));
+		}
+		* projector = updated;
+		mEventRecorder->recordProjectorSnapshot(* projector, * correction);
+	} else if (command == "save") {
+		// Logged like the save key, so replays save at the same point
+		mEventRecorder->record(EventType::KEY_COMMAND, KeyEvent::KEY_s, 's');
+		saveParams();
+	} else if (command == "setRenderMode") {
+		string modeName = request.getValueForKey("mode");
+		vector<string> const modeNames = { "wireframe", "texture", "coverage", "syphon", "alignment" };
+		vector<SphereRenderType> const modeTypes = { SphereRenderType::WIREFRAME, SphereRenderType::TEXTURE, SphereRenderType::PROJECTOR_COVERAGE, SphereRenderType::SYPHON_FRAME };
+		size_t mode = std::find(modeNames.begin(), modeNames.end(), modeName) - modeNames.begin();
+
+		if (!projector) {
+			if (mode >= modeTypes.size()) { return error("invalid main view render mode " + modeName); }
+			mEventRecorder->record(EventType::RENDER_MODE, -1, mode);
+			mSphereRenderType = modeTypes[mode];
+		} else {
+			if (mode >= modeNames.size()) { return error("invalid projector render mode " + modeName); }
+			auto windowList = getSubWindowDataVec();
+			auto windowData = std::find_if(windowList.begin(), windowList.end(), [=] (SubWindowData * winData) { return winData->mProjector == projector; });
+			if (windowData == windowList.end()) { return error("projector " + std::to_string(projector->getId()) + " has no window"); }
+
+			mEventRecorder->record(EventType::RENDER_MODE, projector->getId(), mode);
+			(* windowData)->mRenderArrow = mode == 4;
+			if (mode < modeTypes.size()) {
+				(* windowData)->mSphereRenderType = modeTypes[mode];
+			}
+		}
+	} else if (command == "subscribeStats" || command == "unsubscribeStats") {
+		mControlServer->setStatsSubscription(clientId, command == "subscribeStats");
+	} else {
+		return error("unknown command " + command);
+	}
+
+	return reply.addChild(JsonTree("ok", true));
+}
+
+void DigitalLifeProjectorControlApp::sendFrameStats(double updateStartTime) {
+	double now = getElapsedSeconds();
+	double frameTime = now - mLastFrameTime;
+	mLastFrameTime = now;
+
+	if (!mControlServer->hasStatsSubscribers()) {
+		return;
+	}
+
+	JsonTree stats = JsonTree::makeObject("stats")
+		.addChild(JsonTree("frame", (uint64_t) getElapsedFrames()))
+		.addChild(JsonTree("frameMs", frameTime * 1000.0))
+		.addChild(JsonTree("updateMs", (now - updateStartTime) * 1000.0))
+		.addChild(JsonTree("averageFps", getAverageFps()))
+		.addChild(JsonTree("windows", (int) getNumWindows()));
+
+	mControlServer->broadcastStats(ControlServer::toMessageBody(JsonTree::makeObject().addChild(stats)));
+}
+
+// Times the GL stages of the pipeline on synthetic inputs of increasing size, and writes the results as JSON.
+// They call glFinish() so that the timings include the actual rendering. The CPU stages (mesh loading, params,
+// projector matrices) are in the headless PipelineBenchmark, which builds with CMake and doesn't need a window.
+int DigitalLifeProjectorControlApp::runBenchmarks(fs::path outputFile, fs::path baselineFile, double tolerance) {
+	BenchmarkSuite suite;
+
+	for (uint32_t side : { 512u, 1024u, 2048u }) {
+		FboCubeMapLayeredRef cubeMap = FboCubeMapLayered::create(side, side, FboCubeMapLayered::Format().depth(false));
+		gl::BatchRef convertBatch = gl::Batch::create(makeRowLayoutToCubeMapMesh(side), mFrameToCubeMapConvertShader, { { geom::CUSTOM_0, "faceIndex" } });
+		// Stand-in for the Syphon frame, which is a rectangle texture with the faces in a row
+		gl::TextureRef frame = gl::Texture::create(side * 6, side, gl::Texture::Format().target(GL_TEXTURE_RECTANGLE));
+
+		suite.run("cubeMapRemap/" + std::to_string(side), [&] () {
+			renderFrameToCubeMap(frame, cubeMap, convertBatch);
+			glFinish();
+		});
+	}
+
+	gl::FboRef coverageFbo = gl::Fbo::create(1920, 1080);
+	for (int count : { 1, 4, 10 }) { // The coverage shader holds at most 10 projectors
+		vector<ProjectorRef> projectors = makeBenchmarkProjectors(count);
+
+		suite.run("projectorCoverage/" + std::to_string(count), [&] () {
+			gl::ScopedFramebuffer scpFbo(coverageFbo);
+			gl::ScopedViewport scpView(coverageFbo->getSize());
+			gl::ScopedMatrices scpMat;
+			gl::ScopedDepth scpDepth(true);
+			gl::setMatrices(mCamera);
+			gl::clear(Color(0, 0, 0));
+			drawProjectorCoverage(projectors);
+			glFinish();
+		});
+	}
+
+	return suite.writeResults(outputFile, baselineFile, tolerance);
+}
+
+gl::GlslProgRef DigitalLifeProjectorControlApp::buildShader(string name) {
+	vector<string> const & sources = SHADER_SOURCES.at(name);
+
+	gl::GlslProg::Format format = gl::GlslProg::Format()
+		.vertex(loadAsset(sources[0]))
+		.fragment(loadAsset(sources[1]));
+	if (sources.size() > 2) {
+		format.geometry(loadAsset(sources[2]));
+	}
+	if (name == "syphonFrameAsCubeMapRender_external") {
+		format.define("EXTERNAL_VIEW");
+	}
+
+	return gl::GlslProg::create(format);
+}
+
+void DigitalLifeProjectorControlApp::setShader(string name, gl::GlslProgRef shader) {
+	if (name == "convertFrameToCubeMap") {
+		mFrameToCubeMapConvertShader = shader;
+		// The batch holds on to the shader (and its VAO can't be shared between contexts), so it's rebuilt here
+		mFrameToCubeMapConvertBatch = gl::Batch::create(mFrameToCubeMapConvertMesh, mFrameToCubeMapConvertShader, { { geom::CUSTOM_0, "faceIndex" } });
+	} else if (name == "projectorCoverage") {
+		mProjectorCoverageShader = shader;
+	} else if (name == "syphonFrameAsCubeMapRender_projector") {
+		mSyphonFrameAsCubeMapRenderShader_projector = shader;
+	} else if (name == "syphonFrameAsCubeMapRender_external") {
+		mSyphonFrameAsCubeMapRenderShader_external = shader;
+	}
+}
+
+void DigitalLifeProjectorControlApp::trackAsset(string artifact, vector<fs::path> files) {
+	// getAssetPath() returns an empty path for files that don't exist (yet)
+	files.erase(std::remove(files.begin(), files.end(), fs::path()), files.end());
+	for (auto & file : files) {
+		mFileWatcher.watch(file);
+	}
+	mAssetDependencies.setDependencies(artifact, files);
+}
+
+void DigitalLifeProjectorControlApp::trackShaderDependencies(string name) {
+	vector<fs::path> files;
+	for (auto & source : SHADER_SOURCES.at(name)) {
+		for (auto & file : findShaderDependencies(getAssetPath(source))) {
+			files.push_back(file);
+		}
+	}
+	trackAsset(name, files);
+}
+
+void DigitalLifeProjectorControlApp::hotReloadThreadFn(gl::ContextRef backgroundContext) {
+	ThreadSetup threadSetup;
+	backgroundContext->makeCurrent();
+
+	auto startTime = std::chrono::steady_clock::now();
+	while (mHotReloadRunning) {
+		double now = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		vector<fs::path> changedFiles = mFileWatcher.poll(now);
+		if (!changedFiles.empty()) {
+			rebuildChangedAssets(changedFiles);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+}
+
+void DigitalLifeProjectorControlApp::rebuildChangedAssets(vector<fs::path> const & changedFiles) {
+	HotReload reload;
+
+	for (auto & artifact : mAssetDependencies.getAffectedArtifacts(changedFiles)) {
+		console() << "reloading " << artifact << std::endl;
+		try {
+			if (artifact == "params") {
+				// Read under the lock too, or a save could land between reading the file and comparing it
+				std::lock_guard<std::mutex> lock(mHotReloadMutex);
+				JsonTree paramsTree(loadAsset(mParamsFile));
+				for (auto const & projParams : paramsTree) {
+					int projectorId = projParams.getValueForKey<int>("id");
+					string serializedParams = projParams.serialize();
+					// Projectors that weren't edited in the file keep any unsaved changes made in the app
+					if (mLoadedProjectorParams[projectorId] != serializedParams) {
+						reload.projectors.push_back(parseProjectorParams(projParams));
+						reload.colorCorrections.push_back(parseColorCorrection(this, projParams));
+						mLoadedProjectorParams[projectorId] = serializedParams;
+					}
+				}
+			} else if (artifact == "sphereMesh") {
+				reload.sphereMesh = gl::VboMesh::create(loadSphereMesh(loadAsset(mSphereMeshFile)));
+			} else {
+				// Do this first, so a newly included file that fails to compile is still being watched
+				trackShaderDependencies(artifact);
+				reload.shaders[artifact] = buildShader(artifact);
+			}
+		} catch (std::exception const & exc) {
+			// The old version stays in use until the file is fixed
+			console() << "ERROR: failed to reload " << artifact << ": " << exc.what() << std::endl;
+		}
+	}
+
+	// Make sure the new GL objects are complete before the render thread gets to use them
+	glFinish();
+
+	std::lock_guard<std::mutex> lock(mHotReloadMutex);
+	for (auto & shader : reload.shaders) {
+		mPendingReload.shaders[shader.first] = shader.second;
+	}
+	if (reload.sphereMesh) {
+		mPendingReload.sphereMesh = reload.sphereMesh;
+	}
+	mPendingReload.projectors.insert(mPendingReload.projectors.end(), reload.projectors.begin(), reload.projectors.end());
+	mPendingReload.colorCorrections.insert(mPendingReload.colorCorrections.end(), reload.colorCorrections.begin(), reload.colorCorrections.end());
+}
+
+void DigitalLifeProjectorControlApp::applyHotReload() {
+	HotReload reload;
+	{
+		// Never stall the frame on the reload thread, the changes will still be there next frame
+		std::unique_lock<std::mutex> lock(mHotReloadMutex, std::try_to_lock);
+		if (!lock.owns_lock()) {
+			return;
+		}
+		std::swap(reload, mPendingReload);
+	}
+
+	for (auto & shader : reload.shaders) {
+		setShader(shader.first, shader.second);
+	}
+
+	if (reload.sphereMesh) {
+		mScanSphereMesh = reload.sphereMesh;
+	}
+
+	for (size_t idx = 0; idx < reload.projectors.size(); idx++) {
+		int projectorId = reload.projectors[idx].getId();
+		auto projVecPosition = std::find_if(mProjectorParams.begin(), mProjectorParams.end(), [=] (ProjectorRef const & proj) { return proj->getId() == projectorId; });
+
+		if (projVecPosition == mProjectorParams.end()) {
+			mProjectorParams.push_back(std::make_shared<Projector>(reload.projectors[idx]));
+			mColorCorrections[projectorId] = reload.colorCorrections[idx];
+			mProjectorWindowMap[projectorId] = -1;
+		} else {
+			// Copy into the existing objects, since the windows and the params menu hold on to them
+			** projVecPosition = reload.projectors[idx];
+			* mColorCorrections[projectorId] = * reload.colorCorrections[idx];
+		}
+		mEventRecorder->recordProjectorSnapshot(* reload.projectors[idx], * reload.colorCorrections[idx]);
+		console() << "reloaded projector " << projectorId << std::endl;
+	}
+}
+
+void DigitalLifeProjectorControlApp::saveParams() {
+	// Otherwise the reload thread sees the app's own save as an edit to the file, and reloads it over any
+	// changes made since. The lock is held across the write, so it can't look at the file in between.
+	std::lock_guard<std::mutex> lock(mHotReloadMutex);
+	// Parsed back the same way the reload thread reads the file, so the serializations compare equal
+	JsonTree savedParams(saveProjectorParams(this, mProjectorParams, mColorCorrections, mParamsFile));
+	for (auto const & projParams : savedParams) {
+		mLoadedProjectorParams[projParams.getValueForKey<int>("id")] = projParams.serialize();
 	}
 }
 
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "cinder/DataSource.h"
+#include "cinder/app/KeyEvent.h"
+
+#include "EventLog.h"
+#include "ParamsControl.h"
+
+using namespace ci;
+using std::string;
+using std::vector;
+
+static const char LOG_MAGIC[4] = { 'D', 'L', 'E', 'V' };
+// Version 2 added LUT_FILE records. Version 1 logs can still be read, they just never change the LUTs.
+static const uint32_t LOG_VERSION = 2;
+static const uint32_t OLDEST_LOG_VERSION = 1;
+// Anything longer than this in a LUT_FILE record means the log is corrupt
+static const int32_t MAX_TEXT_LENGTH = 4096;
+
+// Reads the header, and returns the log's version, or 0 if it isn't an event log
+static uint32_t readLogHeader(std::ifstream & logStream) {
+	char magic[4];
+	uint32_t version;
+	logStream.read(magic, sizeof(magic));
+	logStream.read(reinterpret_cast<char *>(& version), sizeof(version));
+	if (!logStream || !std::equal(magic, magic + 4, LOG_MAGIC)) {
+		return 0;
+	}
+	return version;
+}
+
+void applyProjectorField(Projector & proj, ColorCorrection & correction, ProjectorField field, vec3 value) {
+	switch (field) {
+		case ProjectorField::POSITION: proj.moveTo(value); break;
+		case ProjectorField::UPSIDE_DOWN: proj.setUpsideDown(value.x != 0.0f); break;
+		case ProjectorField::Y_ROTATION: proj.setYRotation(value.x); break;
+		case ProjectorField::HOR_FOV: proj.setHorFOV(value.x); break;
+		case ProjectorField::VERT_FOV: proj.setVertFOV(value.x); break;
+		case ProjectorField::BASE_ANGLE: proj.setVertBaseAngle(value.x); break;
+		case ProjectorField::COLOR: proj.setColor(Color(value.x, value.y, value.z)); break;
+		case ProjectorField::GAMMA: correction.setGamma(value); break;
+		case ProjectorField::WHITE_POINT: correction.setWhitePoint(Color(value.x, value.y, value.z)); break;
+	}
+}
+
+EventRecorder::EventRecorder(fs::path logFile) {
+	if (logFile.empty()) {
+		return;
+	}
+
+	bool isNewLog = !fs::exists(logFile) || fs::file_size(logFile) == 0;
+	if (!isNewLog) {
+		std::ifstream existingLog(logFile.string(), std::ios::binary);
+		uint32_t version = readLogHeader(existingLog);
+		existingLog.close();
+		if (version != LOG_VERSION) {
+			// Records can't be appended to a log with a different version, so the old one is moved out of the way
+			fs::path oldLogFile = logFile.string() + ".v" + std::to_string(version);
+			try {
+				fs::rename(logFile, oldLogFile);
+			} catch (std::exception const & exc) {
+				std::cerr << "ERROR: could not move the old event log out of the way, this session won't be recorded: " << exc.what() << std::endl;
+				return;
+			}
+			std::cout << "moved the old event log to " << oldLogFile << std::endl;
+			isNewLog = true;
+		}
+	}
+	mLogStream.open(logFile.string(), std::ios::binary | std::ios::app);
+	if (!mLogStream) {
+		std::cerr << "ERROR: could not open the event log " << logFile << ", this session won't be recorded" << std::endl;
+		return;
+	}
+
+	if (isNewLog) {
+		mLogStream.write(LOG_MAGIC, sizeof(LOG_MAGIC));
+		mLogStream.write(reinterpret_cast<char const *>(& LOG_VERSION), sizeof(LOG_VERSION));
+	}
+}
+
+void EventRecorder::record(EventType type, int32_t id, int32_t extra, vec3 values) {
+	if (!mLogStream.is_open()) {
+		return;
+	}
+
+	writeRecord(type, id, extra, values);
+	// Flush every event, the whole point is to still have the log when something goes wrong
+	mLogStream.flush();
+}
+
+void EventRecorder::writeRecord(EventType type, int32_t id, int32_t extra, vec3 values) {
+	uint64_t timeMicros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+	mLogStream.write(reinterpret_cast<char const *>(& timeMicros), sizeof(timeMicros));
+	mLogStream.write(reinterpret_cast<char const *>(& type), sizeof(type));
+	mLogStream.write(reinterpret_cast<char const *>(& id), sizeof(id));
+	mLogStream.write(reinterpret_cast<char const *>(& extra), sizeof(extra));
+	mLogStream.write(reinterpret_cast<char const *>(& values[0]), sizeof(float) * 3);
+}
+
+void EventRecorder::recordProjectorField(int projectorId, ProjectorField field, vec3 value) {
+	record(EventType::PROJECTOR_PARAM, projectorId, (int32_t) field, value);
+}
+
+void EventRecorder::recordLutFile(int projectorId, string const & lutFile) {
+	if (!mLogStream.is_open()) {
+		return;
+	}
+
+	writeRecord(EventType::LUT_FILE, projectorId, (int32_t) lutFile.size(), vec3(0));
+	mLogStream.write(lutFile.data(), lutFile.size());
+	mLogStream.flush();
+}
+
+void EventRecorder::recordProjectorSnapshot(Projector const & proj, ColorCorrection const & correction) {
+	Color color = proj.getColor();
+	Color whitePoint = correction.getWhitePoint();
+
+	recordProjectorField(proj.getId(), ProjectorField::POSITION, proj.getPos());
+	recordProjectorField(proj.getId(), ProjectorField::UPSIDE_DOWN, vec3(proj.getUpsideDown() ? 1.0f : 0.0f));
+	recordProjectorField(proj.getId(), ProjectorField::Y_ROTATION, vec3(proj.getYRotation()));
+	recordProjectorField(proj.getId(), ProjectorField::HOR_FOV, vec3(proj.getHorFOV()));
+	recordProjectorField(proj.getId(), ProjectorField::VERT_FOV, vec3(proj.getVertFOV()));
+	recordProjectorField(proj.getId(), ProjectorField::BASE_ANGLE, vec3(proj.getVertBaseAngle()));
+	recordProjectorField(proj.getId(), ProjectorField::COLOR, vec3(color.r, color.g, color.b));
+	recordProjectorField(proj.getId(), ProjectorField::GAMMA, correction.getGamma());
+	recordProjectorField(proj.getId(), ProjectorField::WHITE_POINT, vec3(whitePoint.r, whitePoint.g, whitePoint.b));
+	recordLutFile(proj.getId(), correction.getLutFile());
+}
+
+vector<LoggedEvent> readEventLog(fs::path logFile) {
+	vector<LoggedEvent> events;
+	std::ifstream logStream(logFile.string(), std::ios::binary);
+
+	uint32_t version = readLogHeader(logStream);
+	if (version < OLDEST_LOG_VERSION || version > LOG_VERSION) {
+		std::cerr << "ERROR: " << logFile << " is not a version " << OLDEST_LOG_VERSION << " to " << LOG_VERSION << " event log" << std::endl;
+		return events;
+	}
+
+	LoggedEvent event;
+	while (true) {
+		logStream.read(reinterpret_cast<char *>(& event.timeMicros), sizeof(event.timeMicros));
+		logStream.read(reinterpret_cast<char *>(& event.type), sizeof(event.type));
+		logStream.read(reinterpret_cast<char *>(& event.id), sizeof(event.id));
+		logStream.read(reinterpret_cast<char *>(& event.extra), sizeof(event.extra));
+		logStream.read(reinterpret_cast<char *>(& event.values[0]), sizeof(float) * 3);
+		event.text.clear();
+		if (logStream && event.type == EventType::LUT_FILE) {
+			if (event.extra < 0 || event.extra > MAX_TEXT_LENGTH) {
+				std::cerr << "ERROR: corrupt LUT_FILE record in " << logFile << ", ignoring the rest of the log" << std::endl;
+				break;
+			}
+			event.text.resize(event.extra);
+			logStream.read(& event.text[0], event.extra);
+		}
+		if (!logStream) {
+			break;
+		}
+		events.push_back(event);
+	}
+
+	return events;
+}
+
+ProjectorRef EventReplayer::getOrCreateProjector(int projectorId) {
+	auto projVecPosition = std::find_if(mProjectors.begin(), mProjectors.end(), [=] (ProjectorRef const & proj) { return proj->getId() == projectorId; });
+	if (projVecPosition != mProjectors.end()) {
+		return * projVecPosition;
+	}
+
+	// Same defaults as a projector created by opening a new window. The recorder logs its random position and color right after.
+	ProjectorRef projector = std::make_shared<Projector>(getAcerP5515MinZoom());
+	projector->setId(projectorId);
+	mProjectors.push_back(projector);
+	mColorCorrections[projectorId] = std::make_shared<ColorCorrection>();
+	return projector;
+}
+
+void EventReplayer::apply(LoggedEvent const & event) {
+	switch (event.type) {
+		case EventType::SESSION_START:
+			// Each session starts with a snapshot of every projector it loaded, so anything before it is irrelevant
+			mProjectors.clear();
+			mColorCorrections.clear();
+			break;
+		case EventType::PROJECTOR_PARAM: {
+			ProjectorRef projector = getOrCreateProjector(event.id);
+			applyProjectorField(* projector, * mColorCorrections[event.id], (ProjectorField) event.extra, event.values);
+			break;
+		}
+		case EventType::WINDOW_CREATED:
+			getOrCreateProjector(event.extra);
+			break;
+		case EventType::LUT_FILE:
+			getOrCreateProjector(event.id);
+			loadLutFile(* mColorCorrections[event.id], event.text);
+			break;
+		case EventType::KEY_COMMAND:
+			if (event.id == app::KeyEvent::KEY_s) {
+				mLastSavedParams = serializeAllProjectorParams(mProjectors, mColorCorrections).serialize();
+				mNumSaves += 1;
+			}
+			break;
+		default:
+			// Everything else only affects what's on screen
+			break;
+	}
+}
+
+void EventReplayer::loadLutFile(ColorCorrection & correction, string const & lutFile) {
+	vector<float> baseLut;
+	int lutSize = 0;
+	if (!lutFile.empty() && !mAssetsDir.empty()) {
+		try {
+			baseLut = loadCubeLut(loadFile(mAssetsDir / lutFile), & lutSize);
+		} catch (std::exception const & exc) {
+			std::cerr << "Failed to load color correction LUT " << lutFile << " : " << exc.what() << std::endl;
+		}
+	}
+	// Like parseColorCorrection, the name is kept even if the file couldn't be loaded
+	correction.setBaseLut(baseLut, lutSize, lutFile);
+}
+
+int replayEventLog(fs::path const & logFile, fs::path const & outputFile, fs::path const & assetsDir) {
+	vector<LoggedEvent> events = readEventLog(logFile);
+	if (events.empty()) {
+		std::cerr << "ERROR: no events to replay in " << logFile << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	EventReplayer replayer(assetsDir);
+	auto start = std::chrono::steady_clock::now();
+	for (auto & event : events) {
+		replayer.apply(event);
+	}
+	double replayMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << "replayed " << events.size() << " events (" << replayer.getNumSaves() << " saves) in " << replayMs << " ms, "
+		<< events.size() / std::max(replayMs / 1000.0, 1e-9) << " events/s" << std::endl;
+
+	// The params file after the session is whatever the last save wrote, so that's what gets written here
+	string finalParams = serializeAllProjectorParams(replayer.getProjectors(), replayer.getColorCorrections()).serialize();
+	string outputParams = finalParams;
+	if (replayer.getNumSaves() == 0) {
+		std::cout << "nothing was saved in this log, writing the params it ended with instead" << std::endl;
+	} else {
+		outputParams = replayer.getLastSavedParams();
+		if (outputParams != finalParams) {
+			std::cout << "the log ends with unsaved changes, they're not in the written params" << std::endl;
+		}
+	}
+
+	std::ofstream writeFile(outputFile.string());
+	writeFile << outputParams;
+	writeFile.close();
+	if (!writeFile) {
+		std::cerr << "ERROR: could not write the replayed params to " << outputFile << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "wrote replayed params to: " << outputFile << std::endl;
+	return EXIT_SUCCESS;
+}
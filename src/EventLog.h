@@ -0,0 +1,110 @@
+#pragma once
+
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cinder/Filesystem.h"
+
+#include "Projector.h"
+
+#include "ColorCorrection.h"
+
+typedef std::shared_ptr<class EventRecorder> EventRecorderRef;
+
+enum class EventType : uint8_t {
+	SESSION_START,
+	PROJECTOR_PARAM,
+	KEY_COMMAND,
+	WINDOW_CREATED,
+	WINDOW_CLOSED,
+	RENDER_MODE,
+	LUT_FILE
+};
+
+// Everything about a projector that can be edited while calibrating
+enum class ProjectorField : int32_t {
+	POSITION,
+	UPSIDE_DOWN,
+	Y_ROTATION,
+	HOR_FOV,
+	VERT_FOV,
+	BASE_ANGLE,
+	COLOR,
+	GAMMA,
+	WHITE_POINT
+};
+
+// One record in the log. What id and extra mean depends on the type:
+//   PROJECTOR_PARAM: projector id, ProjectorField (the new value is in values)
+//   KEY_COMMAND: key code, key char
+//   WINDOW_CREATED / WINDOW_CLOSED: window id, projector id
+//   RENDER_MODE: projector id (-1 for the main view), render mode menu index
+//   LUT_FILE: projector id, length of the file name, which follows the fixed-size part of the record
+struct LoggedEvent {
+	uint64_t timeMicros;
+	EventType type;
+	int32_t id;
+	int32_t extra;
+	ci::vec3 values;
+	std::string text;
+};
+
+// Every edit goes through here, both live and in replays, so a replay ends up in exactly the same state
+void applyProjectorField(Projector & proj, ColorCorrection & correction, ProjectorField field, ci::vec3 value);
+
+// Appends events to a binary log as they happen, so a calibration session can be replayed later.
+// Records are written in the machine's byte order, which is little-endian everywhere this runs.
+class EventRecorder {
+public:
+	// An empty path gives a recorder that doesn't record anything
+	static EventRecorderRef create(ci::fs::path logFile) { return EventRecorderRef(new EventRecorder(logFile)); }
+
+	void record(EventType type, int32_t id, int32_t extra = 0, ci::vec3 values = ci::vec3(0));
+	void recordProjectorField(int projectorId, ProjectorField field, ci::vec3 value);
+	// An empty file name means the projector has no base LUT
+	void recordLutFile(int projectorId, std::string const & lutFile);
+	// Records every field, for changes that replace a projector's params wholesale
+	void recordProjectorSnapshot(Projector const & proj, ColorCorrection const & correction);
+
+private:
+	EventRecorder(ci::fs::path logFile);
+
+	void writeRecord(EventType type, int32_t id, int32_t extra, ci::vec3 values);
+
+	std::ofstream mLogStream;
+};
+
+// Reads a whole log. A truncated record at the end (from a crash mid-write) is ignored.
+std::vector<LoggedEvent> readEventLog(ci::fs::path logFile);
+
+// Re-applies logged events to a set of projectors, without any windows or GL
+class EventReplayer {
+public:
+	// LUT files are loaded from assetsDir. Without one, only their names are kept.
+	EventReplayer(ci::fs::path assetsDir = ci::fs::path()) : mAssetsDir(assetsDir) {}
+
+	void apply(LoggedEvent const & event);
+
+	std::vector<ProjectorRef> const & getProjectors() const { return mProjectors; }
+	std::map<int, ColorCorrectionRef> const & getColorCorrections() const { return mColorCorrections; }
+	// The params file as it would have been written by the last save in the log
+	std::string const & getLastSavedParams() const { return mLastSavedParams; }
+	int getNumSaves() const { return mNumSaves; }
+
+private:
+	ProjectorRef getOrCreateProjector(int projectorId);
+	void loadLutFile(ColorCorrection & correction, std::string const & lutFile);
+
+	ci::fs::path mAssetsDir;
+	std::vector<ProjectorRef> mProjectors;
+	std::map<int, ColorCorrectionRef> mColorCorrections;
+	std::string mLastSavedParams;
+	int mNumSaves = 0;
+};
+
+// Replays a whole log as fast as possible, and writes the params file it leaves behind: the params as of
+// the last save, or the final state if nothing was saved. Returns the exit code for the replay run.
+int replayEventLog(ci::fs::path const & logFile, ci::fs::path const & outputFile, ci::fs::path const & assetsDir);
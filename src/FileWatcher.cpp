@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "FileWatcher.h"
+
+using namespace ci;
+using std::string;
+using std::vector;
+
+void FileWatcher::watch(fs::path const & file) {
+	if (mFiles.find(file) == mFiles.end()) {
+		mFiles[file] = readState(file);
+	}
+}
+
+FileWatcher::FileState FileWatcher::readState(fs::path const & file) {
+	FileState state = FileState();
+	// Some editors save by deleting and re-creating the file, so it can briefly disappear
+	try {
+		state.modified = fs::last_write_time(file);
+		state.size = fs::file_size(file);
+		state.exists = true;
+	} catch (std::exception const &) {
+		state.exists = false;
+	}
+	return state;
+}
+
+vector<fs::path> FileWatcher::poll(double now) {
+	vector<fs::path> changedFiles;
+
+	for (auto & file : mFiles) {
+		FileState current = readState(file.first);
+		FileState & previous = file.second;
+
+		if (current.exists != previous.exists || current.modified != previous.modified || current.size != previous.size) {
+			previous.exists = current.exists;
+			previous.modified = current.modified;
+			previous.size = current.size;
+			previous.pending = true;
+			previous.changedAt = now;
+		} else if (previous.pending && previous.exists && now - previous.changedAt >= mDebounceSeconds) {
+			// A file that's been deleted stays pending until it comes back
+			previous.pending = false;
+			changedFiles.push_back(file.first);
+		}
+	}
+
+	return changedFiles;
+}
+
+void AssetDependencies::setDependencies(string artifact, vector<fs::path> files) {
+	mDependencies[artifact] = std::move(files);
+}
+
+vector<fs::path> const & AssetDependencies::getDependencies(string const & artifact) const {
+	static const vector<fs::path> noDependencies;
+	auto dependencies = mDependencies.find(artifact);
+	return dependencies == mDependencies.end() ? noDependencies : dependencies->second;
+}
+
+std::set<string> AssetDependencies::getAffectedArtifacts(vector<fs::path> const & changedFiles) const {
+	std::set<string> affected;
+	for (auto & artifact : mDependencies) {
+		for (auto & file : changedFiles) {
+			if (std::find(artifact.second.begin(), artifact.second.end(), file) != artifact.second.end()) {
+				affected.insert(artifact.first);
+				break;
+			}
+		}
+	}
+	return affected;
+}
+
+vector<string> parseShaderIncludes(string const & source) {
+	vector<string> includes;
+	std::istringstream sourceStream(source);
+	string line;
+
+	while (std::getline(sourceStream, line)) {
+		size_t directive = line.find_first_not_of(" \t");
+		if (directive == string::npos || line.compare(directive, 8, "#include") != 0) {
+			continue;
+		}
+		size_t nameStart = line.find('"', directive + 8);
+		size_t nameEnd = nameStart == string::npos ? string::npos : line.find('"', nameStart + 1);
+		if (nameEnd != string::npos) {
+			includes.push_back(line.substr(nameStart + 1, nameEnd - nameStart - 1));
+		}
+	}
+
+	return includes;
+}
+
+vector<fs::path> findShaderDependencies(fs::path const & shaderFile) {
+	vector<fs::path> dependencies;
+	vector<fs::path> toVisit = { shaderFile };
+
+	while (!toVisit.empty()) {
+		fs::path file = toVisit.back();
+		toVisit.pop_back();
+		if (std::find(dependencies.begin(), dependencies.end(), file) != dependencies.end()) {
+			continue;
+		}
+		dependencies.push_back(file);
+
+		std::ifstream fileStream(file.string());
+		std::stringstream source;
+		source << fileStream.rdbuf();
+		for (auto & include : parseShaderIncludes(source.str())) {
+			toVisit.push_back(file.parent_path() / include);
+		}
+	}
+
+	return dependencies;
+}
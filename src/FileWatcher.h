@@ -0,0 +1,58 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "cinder/Filesystem.h"
+
+// Polls the modification times of a set of files. It has no thread of its own and the current
+// time is passed in, so it can be driven from any thread (and doesn't need GL or an app to run).
+class FileWatcher {
+public:
+	// Editors often save in several steps, so a change is only reported once the file has stopped
+	// changing for debounceSeconds
+	explicit FileWatcher(double debounceSeconds = 0.25) : mDebounceSeconds(debounceSeconds) {}
+
+	// Watching a file twice is harmless
+	void watch(ci::fs::path const & file);
+
+	// Returns every watched file whose changes have settled since the last call
+	std::vector<ci::fs::path> poll(double now);
+
+private:
+	typedef decltype(ci::fs::last_write_time(ci::fs::path())) FileTime;
+
+	struct FileState {
+		bool exists;
+		FileTime modified;
+		uintmax_t size;
+		bool pending;
+		double changedAt;
+	};
+
+	static FileState readState(ci::fs::path const & file);
+
+	double mDebounceSeconds;
+	std::map<ci::fs::path, FileState> mFiles;
+};
+
+// Keeps track of which artifacts (a shader program, the mesh...) are built from which files
+class AssetDependencies {
+public:
+	// Replaces whatever the artifact depended on before
+	void setDependencies(std::string artifact, std::vector<ci::fs::path> files);
+	std::vector<ci::fs::path> const & getDependencies(std::string const & artifact) const;
+	std::set<std::string> getAffectedArtifacts(std::vector<ci::fs::path> const & changedFiles) const;
+
+private:
+	std::map<std::string, std::vector<ci::fs::path>> mDependencies;
+};
+
+// Returns the file names from every #include "file" line in a shader source
+std::vector<std::string> parseShaderIncludes(std::string const & source);
+
+// Returns the shader file and everything it (recursively) includes. Includes are resolved relative to
+// the including file, like the GlslProg preprocessor does for our assets.
+std::vector<ci::fs::path> findShaderDependencies(ci::fs::path const & shaderFile);
@@ -2,6 +2,7 @@
 
 using namespace ci;
 using std::string;
+using std::vector;
 
 vec3 parseVector(JsonTree vec) {
 	return vec3(vec.getValueAtIndex<float>(0), vec.getValueAtIndex<float>(1), vec.getValueAtIndex<float>(2));
@@ -23,6 +24,34 @@ Projector parseProjectorParams(JsonTree const & params) {
 		.setColor(parseColor(params.getChild("color")));
 }
 
+ColorCorrectionRef parseColorCorrection(app::App * theApp, JsonTree const & params) {
+	ColorCorrectionRef correction = std::make_shared<ColorCorrection>();
+
+	// Params files saved before color correction existed don't have this key, so just use the defaults
+	if (!params.hasChild("colorCorrection")) {
+		return correction;
+	}
+
+	JsonTree const & correctionParams = params.getChild("colorCorrection");
+	correction->setGamma(parseVector(correctionParams.getChild("gamma")))
+		.setWhitePoint(parseColor(correctionParams.getChild("whitePoint")));
+
+	if (correctionParams.hasChild("lutFile")) {
+		string lutFile = correctionParams.getValueForKey("lutFile");
+		int lutSize = 0;
+		vector<float> baseLut;
+		try {
+			baseLut = loadCubeLut(theApp->loadAsset(lutFile), & lutSize);
+		} catch (std::exception const & exc) {
+			app::console() << "Failed to load color correction LUT " << lutFile << " : " << exc.what() << std::endl;
+		}
+		// Even if it failed to load, so the file name isn't dropped from the params on the next save
+		correction->setBaseLut(baseLut, lutSize, lutFile);
+	}
+
+	return correction;
+}
+
 JsonTree loadProjectorParams(app::App * theApp, string paramFileName) {
 	try {
 		return JsonTree(theApp->loadAsset(paramFileName));
@@ -62,14 +91,35 @@ JsonTree serializeProjector(Projector const & proj) {
 		.addChild(serializeColor("color", proj.getColor()));
 }
 
-void saveProjectorParams(app::App * theApp, std::vector<ProjectorRef> const & theData, string paramFileName) {
+JsonTree serializeColorCorrection(ColorCorrection const & correction) {
+	JsonTree correctionTree = JsonTree::makeObject("colorCorrection")
+		.addChild(serializeVector("gamma", correction.getGamma()))
+		.addChild(serializeColor("whitePoint", correction.getWhitePoint()));
+
+	if (!correction.getLutFile().empty()) {
+		correctionTree.addChild(JsonTree("lutFile", correction.getLutFile()));
+	}
+
+	return correctionTree;
+}
+
+JsonTree serializeAllProjectorParams(std::vector<ProjectorRef> const & theData, std::map<int, ColorCorrectionRef> const & theCorrections) {
 	JsonTree appParams;
 
 	for (auto & proj : theData) {
-		appParams.addChild(serializeProjector(* proj));
+		JsonTree projParams = serializeProjector(* proj);
+		auto correction = theCorrections.find(proj->getId());
+		if (correction != theCorrections.end()) {
+			projParams.addChild(serializeColorCorrection(* correction->second));
+		}
+		appParams.addChild(projParams);
 	}
 
-	string serializedParams = appParams.serialize();
+	return appParams;
+}
+
+string saveProjectorParams(app::App * theApp, std::vector<ProjectorRef> const & theData, std::map<int, ColorCorrectionRef> const & theCorrections, string paramFileName) {
+	string serializedParams = serializeAllProjectorParams(theData, theCorrections).serialize();
 	std::ofstream writeFile;
 
 	// Write to local file
@@ -96,4 +146,6 @@ void saveProjectorParams(app::App * theApp, std::vector<ProjectorRef> const & th
 	// } catch (fs::filesystem_error exp) {
 	// 	app::console() << "Encountered an error while reading from a file: " << exp.what() << std::endl;
 	// }
+
+	return serializedParams;
 }
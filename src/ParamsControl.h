@@ -1,12 +1,19 @@
 #pragma once
 
+#include <map>
 #include <string>
 
 #include "cinder/app/App.h"
 
 #include "Projector.h"
 
+#include "ColorCorrection.h"
+
 ci::JsonTree loadProjectorParams(ci::app::App * theApp, std::string paramFileName);
 Projector parseProjectorParams(ci::JsonTree const & params);
 ci::JsonTree serializeProjector(Projector const & proj);
-void saveProjectorParams(ci::app::App * theApp, std::vector<ProjectorRef> const & theData, std::string paramFileName);
\ No newline at end of file
+ColorCorrectionRef parseColorCorrection(ci::app::App * theApp, ci::JsonTree const & params);
+ci::JsonTree serializeColorCorrection(ColorCorrection const & correction);
+ci::JsonTree serializeAllProjectorParams(std::vector<ProjectorRef> const & theData, std::map<int, ColorCorrectionRef> const & theCorrections);
+// Returns the serialized params that were written, so the app can tell its own saves apart from edits to the file
+std::string saveProjectorParams(ci::app::App * theApp, std::vector<ProjectorRef> const & theData, std::map<int, ColorCorrectionRef> const & theCorrections, std::string paramFileName);
\ No newline at end of file
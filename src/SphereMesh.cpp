@@ -0,0 +1,24 @@
+#include "cinder/ObjLoader.h"
+
+#include "SphereMesh.h"
+
+using namespace ci;
+
+const vec3 MAGIC_SPHERE_ORIGIN(0.00582, 0.31940, -0.01190);
+
+TriMesh loadSphereMesh(DataSourceRef objSource) {
+	ObjLoader meshLoader(objSource);
+	TriMesh sphereMesh(meshLoader, TriMesh::Format().positions().normals().texCoords0(2).texCoords1(3));
+	generateCubeMapTexCoords(sphereMesh, MAGIC_SPHERE_ORIGIN);
+	return sphereMesh;
+}
+
+void generateCubeMapTexCoords(TriMesh & mesh, vec3 origin) {
+	mesh.getBufferTexCoords1().resize(mesh.getNumVertices() * 3); // 3-dimensional tex coord
+
+	vec3 const * positions = mesh.getPositions<3>();
+	vec3 * cubeMapTexCoords = mesh.getTexCoords1<3>();
+	for (size_t idx = 0; idx < mesh.getNumVertices(); idx++) {
+		cubeMapTexCoords[idx] = normalize(positions[idx] - origin);
+	}
+}
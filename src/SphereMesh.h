@@ -0,0 +1,15 @@
+#pragma once
+
+#include "cinder/TriMesh.h"
+#include "cinder/DataSource.h"
+
+// The center of the scanned sphere, which the cubemap is projected out from
+// I know this because of magic
+extern const ci::vec3 MAGIC_SPHERE_ORIGIN;
+
+// Loads the scan OBJ with the 3D cubemap texture coordinates in texCoords1
+ci::TriMesh loadSphereMesh(ci::DataSourceRef objSource);
+
+// Fills texCoords1 with the direction from origin to each vertex
+// TODO: do this in a script and bake these coordinates into the mesh
+void generateCubeMapTexCoords(ci::TriMesh & mesh, ci::vec3 origin);
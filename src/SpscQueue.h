@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+// Fixed-size lock-free queue for exactly one producer thread and one consumer thread.
+// push() and pop() never block, they just fail when the queue is full or empty.
+template <typename T>
+class SpscQueue {
+public:
+	explicit SpscQueue(size_t capacity) : mSlots(capacity + 1), mHead(0), mTail(0) {}
+
+	// Producer side. value is only moved from if there was room for it.
+	bool push(T && value) {
+		size_t tail = mTail.load(std::memory_order_relaxed);
+		size_t next = advance(tail);
+		if (next == mHead.load(std::memory_order_acquire)) {
+			return false;
+		}
+		mSlots[tail] = std::move(value);
+		mTail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side
+	bool pop(T & value) {
+		size_t head = mHead.load(std::memory_order_relaxed);
+		if (head == mTail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		value = std::move(mSlots[head]);
+		mHead.store(advance(head), std::memory_order_release);
+		return true;
+	}
+
+private:
+	size_t advance(size_t index) const { return (index + 1) % mSlots.size(); }
+
+	// One slot is always left empty, to tell a full queue apart from an empty one
+	std::vector<T> mSlots;
+	std::atomic<size_t> mHead;
+	std::atomic<size_t> mTail;
+};
@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "ColorCorrection.h"
+
+#include "TestCheck.h"
+
+using namespace ci;
+using std::vector;
+
+// Bakes the color correction tables against values worked out by hand, and parses .cube files.
+// None of this needs GL, so it runs headless.
+
+static bool near(float a, float b) {
+	return std::abs(a - b) < 1e-5f;
+}
+
+// The RGB triplet for one entry, red varying fastest
+static float const * lutEntry(vector<float> const & lut, int lutSize, int r, int g, int b) {
+	return & lut[((b * lutSize + g) * lutSize + r) * 3];
+}
+
+static vector<float> bake(int lutSize, float const * baseLut, vec3 gamma, Color whitePoint) {
+	vector<float> lut(lutSize * lutSize * lutSize * 3);
+	bakeColorCorrectionLut(lut.data(), lutSize, baseLut, gamma, whitePoint);
+	return lut;
+}
+
+static void testIdentity() {
+	int lutSize = ColorCorrection::DEFAULT_LUT_SIZE;
+	vector<float> lut = bake(lutSize, nullptr, vec3(1.0f), Color(1.0f, 1.0f, 1.0f));
+
+	float const * entry = lutEntry(lut, lutSize, 3, 5, 7);
+	CHECK(near(entry[0], 3.0f / 16.0f) && near(entry[1], 5.0f / 16.0f) && near(entry[2], 7.0f / 16.0f));
+	float const * white = lutEntry(lut, lutSize, 16, 16, 16);
+	CHECK(near(white[0], 1.0f) && near(white[1], 1.0f) && near(white[2], 1.0f));
+}
+
+static void testGamma() {
+	// With 3 entries per side, the middle one is exactly 0.5
+	vector<float> lut = bake(3, nullptr, vec3(2.2f), Color(1.0f, 1.0f, 1.0f));
+	float const * mid = lutEntry(lut, 3, 1, 1, 1);
+	CHECK(near(mid[0], 0.2176376f) && near(mid[1], 0.2176376f) && near(mid[2], 0.2176376f));
+
+	// Black and white are fixed points of any gamma
+	CHECK(near(lutEntry(lut, 3, 0, 0, 0)[0], 0.0f));
+	CHECK(near(lutEntry(lut, 3, 2, 2, 2)[2], 1.0f));
+
+	// Each channel gets its own gamma
+	lut = bake(3, nullptr, vec3(1.0f, 2.0f, 3.0f), Color(1.0f, 1.0f, 1.0f));
+	mid = lutEntry(lut, 3, 1, 1, 1);
+	CHECK(near(mid[0], 0.5f) && near(mid[1], 0.25f) && near(mid[2], 0.125f));
+}
+
+static void testWhitePoint() {
+	// The white point scales each channel before the gamma, and the result is clamped to [0, 1]
+	vector<float> lut = bake(3, nullptr, vec3(1.0f), Color(0.5f, 1.0f, 2.0f));
+	float const * mid = lutEntry(lut, 3, 1, 1, 1);
+	CHECK(near(mid[0], 0.25f) && near(mid[1], 0.5f) && near(mid[2], 1.0f));
+	float const * white = lutEntry(lut, 3, 2, 2, 2);
+	CHECK(near(white[0], 0.5f) && near(white[1], 1.0f) && near(white[2], 1.0f));
+
+	lut = bake(3, nullptr, vec3(2.0f), Color(0.5f, 0.5f, 0.5f));
+	white = lutEntry(lut, 3, 2, 2, 2);
+	CHECK(near(white[0], 0.25f) && near(white[1], 0.25f) && near(white[2], 0.25f));
+}
+
+static void testBaseLut() {
+	// A 2x2x2 base table that swaps red and blue, and has one out of range value
+	vector<float> baseLut;
+	for (int b = 0; b < 2; b++) {
+		for (int g = 0; g < 2; g++) {
+			for (int r = 0; r < 2; r++) {
+				baseLut.insert(baseLut.end(), { (float) b, (float) g, (float) r });
+			}
+		}
+	}
+	baseLut[1] = 1.5f;
+
+	vector<float> lut = bake(2, baseLut.data(), vec3(1.0f), Color(1.0f, 1.0f, 1.0f));
+	float const * red = lutEntry(lut, 2, 1, 0, 0);
+	CHECK(near(red[0], 0.0f) && near(red[1], 0.0f) && near(red[2], 1.0f));
+	CHECK(near(lut[1], 1.0f));
+
+	lut = bake(2, baseLut.data(), vec3(2.0f), Color(0.5f, 0.5f, 0.5f));
+	red = lutEntry(lut, 2, 1, 0, 0);
+	CHECK(near(red[2], 0.25f));
+}
+
+static void testLoadCubeLut() {
+	fs::path lutFile = fs::temp_directory_path() / "colorCorrectionTest.cube";
+
+	{
+		std::ofstream writeFile(lutFile.string());
+		writeFile << "# Created by hand\n"
+			<< "TITLE \"test\"\n"
+			<< "LUT_3D_SIZE 2\n"
+			<< "DOMAIN_MIN 0 0 0\n"
+			<< "DOMAIN_MAX 1 1 1\n"
+			<< "\n"
+			<< "0 0 0\n1 0 0\n0 1 0\n1 1 0\n"
+			<< "0 0 1\n1 0 1\n0 1 1\n.5 .25 -0.125\n";
+	}
+	int lutSize = 0;
+	vector<float> lut = loadCubeLut(loadFile(lutFile), & lutSize);
+	CHECK(lutSize == 2);
+	CHECK(lut.size() == 2 * 2 * 2 * 3);
+	if (lut.size() == 2 * 2 * 2 * 3) {
+		float const * red = lutEntry(lut, 2, 1, 0, 0);
+		CHECK(near(red[0], 1.0f) && near(red[1], 0.0f) && near(red[2], 0.0f));
+		float const * last = lutEntry(lut, 2, 1, 1, 1);
+		CHECK(near(last[0], 0.5f) && near(last[1], 0.25f) && near(last[2], -0.125f));
+	}
+
+	// One entry short
+	{
+		std::ofstream writeFile(lutFile.string());
+		writeFile << "LUT_3D_SIZE 2\n0 0 0\n1 0 0\n0 1 0\n1 1 0\n0 0 1\n1 0 1\n0 1 1\n";
+	}
+	lutSize = 0;
+	CHECK(loadCubeLut(loadFile(lutFile), & lutSize).empty());
+	CHECK(lutSize == 0);
+
+	// Sizes outside of 2..256 are rejected before anything is allocated for them
+	for (char const * sizeLine : { "LUT_3D_SIZE -2\n", "LUT_3D_SIZE 1\n", "LUT_3D_SIZE 257\n", "LUT_3D_SIZE 2000000\n", "LUT_3D_SIZE big\n" }) {
+		{
+			std::ofstream writeFile(lutFile.string());
+			writeFile << sizeLine << "0 0 0\n1 1 1\n";
+		}
+		CHECK(loadCubeLut(loadFile(lutFile), & lutSize).empty());
+		CHECK(lutSize == 0);
+	}
+
+	// No size at all
+	{
+		std::ofstream writeFile(lutFile.string());
+		writeFile << "0 0 0\n1 1 1\n";
+	}
+	CHECK(loadCubeLut(loadFile(lutFile), & lutSize).empty());
+
+	fs::remove(lutFile);
+}
+
+static void testMissingLutKeepsFileName() {
+	// What parseColorCorrection does when the .cube file fails to load
+	ColorCorrection correction;
+	correction.setGamma(vec3(2.2f)).setBaseLut(vector<float>(), 0, "missing.cube");
+	CHECK(correction.getLutFile() == "missing.cube");
+	CHECK(correction.getLutSize() == ColorCorrection::DEFAULT_LUT_SIZE);
+
+	vector<float> const & lut = correction.getLut();
+	CHECK(lut.size() == (size_t) (ColorCorrection::DEFAULT_LUT_SIZE * ColorCorrection::DEFAULT_LUT_SIZE * ColorCorrection::DEFAULT_LUT_SIZE * 3));
+	CHECK(near(lutEntry(lut, ColorCorrection::DEFAULT_LUT_SIZE, 8, 8, 8)[1], 0.2176376f));
+}
+
+// Trilinear filtering done the long way, one pixel at a time, to check applyColorLut against
+static void referenceLookup(vector<float> const & lut, int lutSize, float const * color, float * result) {
+	int cell[3];
+	float weight[3];
+	for (int c = 0; c < 3; c++) {
+		float coord = std::min(std::max(color[c], 0.0f), 1.0f) * (lutSize - 1);
+		cell[c] = std::min((int) std::floor(coord), lutSize - 2);
+		weight[c] = coord - cell[c];
+	}
+	for (int c = 0; c < 3; c++) {
+		result[c] = 0.0f;
+		for (int corner = 0; corner < 8; corner++) {
+			int dr = corner & 1, dg = (corner >> 1) & 1, db = (corner >> 2) & 1;
+			float cornerWeight = (dr ? weight[0] : 1.0f - weight[0]) * (dg ? weight[1] : 1.0f - weight[1]) * (db ? weight[2] : 1.0f - weight[2]);
+			result[c] += cornerWeight * lutEntry(lut, lutSize, cell[0] + dr, cell[1] + dg, cell[2] + db)[c];
+		}
+	}
+}
+
+static void testApplyColorLut() {
+	// The identity table leaves colors alone, between the lattice points too
+	int lutSize = ColorCorrection::DEFAULT_LUT_SIZE;
+	vector<float> lut = bake(lutSize, nullptr, vec3(1.0f), Color(1.0f, 1.0f, 1.0f));
+	vector<float> colors = { 0.0f, 0.5f, 1.0f, 0.123f, 0.456f, 0.789f, 1.0f / 16.0f, 0.999f, 0.001f };
+	vector<float> result(colors.size());
+	applyColorLut(lut.data(), lutSize, colors.data(), result.data(), colors.size() / 3);
+	for (size_t i = 0; i < colors.size(); i++) {
+		CHECK(near(result[i], colors[i]));
+	}
+
+	// Out of range colors are clamped, like the shader does, and a NaN can't read outside the table
+	colors = { -1.0f, 2.0f, std::nanf("") };
+	applyColorLut(lut.data(), lutSize, colors.data(), result.data(), 1);
+	CHECK(near(result[0], 0.0f) && near(result[1], 1.0f) && near(result[2], 1.0f));
+
+	// On a lattice point it's the baked value, and halfway between two it's their average
+	lut = bake(3, nullptr, vec3(2.2f), Color(1.0f, 1.0f, 1.0f));
+	colors = { 0.5f, 0.25f, 0.75f };
+	applyColorLut(lut.data(), 3, colors.data(), result.data(), 1);
+	CHECK(near(result[0], 0.2176376f));
+	CHECK(near(result[1], 0.2176376f / 2.0f));
+	CHECK(near(result[2], (0.2176376f + 1.0f) / 2.0f));
+
+	// A table that swaps red and blue is linear, so it swaps them exactly everywhere
+	vector<float> swapLut;
+	for (int b = 0; b < 2; b++) {
+		for (int g = 0; g < 2; g++) {
+			for (int r = 0; r < 2; r++) {
+				swapLut.insert(swapLut.end(), { (float) b, (float) g, (float) r });
+			}
+		}
+	}
+	colors = { 0.1f, 0.2f, 0.7f };
+	applyColorLut(swapLut.data(), 2, colors.data(), result.data(), 1);
+	CHECK(near(result[0], 0.7f) && near(result[1], 0.2f) && near(result[2], 0.1f));
+
+	// And a real correction, over more pixels than fit in one block, done in place
+	lutSize = 33;
+	lut = bake(lutSize, nullptr, vec3(2.2f, 1.8f, 2.4f), Color(0.9f, 1.0f, 1.1f));
+	size_t const numPixels = 1000;
+	colors.resize(numPixels * 3);
+	for (size_t i = 0; i < colors.size(); i++) {
+		colors[i] = (float) ((i * 7919) % 1201) / 1100.0f - 0.05f;
+	}
+	vector<float> expected(colors.size());
+	for (size_t pixel = 0; pixel < numPixels; pixel++) {
+		referenceLookup(lut, lutSize, & colors[pixel * 3], & expected[pixel * 3]);
+	}
+	applyColorLut(lut.data(), lutSize, colors.data(), colors.data(), numPixels);
+	int numWrong = 0;
+	for (size_t i = 0; i < colors.size(); i++) {
+		numWrong += near(colors[i], expected[i]) ? 0 : 1;
+	}
+	CHECK(numWrong == 0);
+}
+
+int main() {
+	testIdentity();
+	testGamma();
+	testWhitePoint();
+	testBaseLut();
+	testLoadCubeLut();
+	testMissingLutKeepsFileName();
+	testApplyColorLut();
+
+	return finishTests("color correction");
+}
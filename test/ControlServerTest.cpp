@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "ControlServer.h"
+
+#include "TestCheck.h"
+
+using namespace ci;
+using std::string;
+using std::vector;
+
+// Talks to a ControlServer over loopback, with the main thread standing in for the render thread.
+
+typedef std::chrono::steady_clock Clock;
+
+// A blocking client socket, which gives up on reads after a few seconds so a broken server can't hang the test
+class TestClient {
+public:
+	TestClient(uint16_t port) {
+		mSocket = socket(AF_INET, SOCK_STREAM, 0);
+		timeval timeout = { 5, 0 };
+		setsockopt(mSocket, SOL_SOCKET, SO_RCVTIMEO, & timeout, sizeof(timeout));
+
+		sockaddr_in address;
+		memset(& address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		mConnected = connect(mSocket, (sockaddr *) & address, sizeof(address)) == 0;
+	}
+
+	~TestClient() {
+		close(mSocket);
+	}
+
+	bool isConnected() const { return mConnected; }
+
+	void send(string const & lines) {
+		size_t numSent = 0;
+		while (numSent < lines.size()) {
+			ssize_t result = ::send(mSocket, lines.data() + numSent, lines.size() - numSent, 0);
+			if (result <= 0) {
+				return;
+			}
+			numSent += result;
+		}
+	}
+
+	void shutdownWrite() {
+		shutdown(mSocket, SHUT_WR);
+	}
+
+	// Returns false on timeout or when the server closed the connection
+	bool readLine(string & line) {
+		size_t lineEnd;
+		while ((lineEnd = mBuffer.find('\n')) == string::npos) {
+			char buffer[4096];
+			ssize_t numRead = recv(mSocket, buffer, sizeof(buffer), 0);
+			if (numRead <= 0) {
+				return false;
+			}
+			mBuffer.append(buffer, numRead);
+		}
+		line = mBuffer.substr(0, lineEnd);
+		mBuffer.erase(0, lineEnd + 1);
+		return true;
+	}
+
+private:
+	int mSocket;
+	bool mConnected;
+	string mBuffer;
+};
+
+// What the app does with each request, minus the actual commands: echo the id back
+static int handleRequests(ControlServerRef server, int numRequests) {
+	int numHandled = 0;
+	auto deadline = Clock::now() + std::chrono::seconds(5);
+	ControlMessage request;
+	while (numHandled < numRequests && Clock::now() < deadline) {
+		if (!server->popRequest(request)) {
+			continue;
+		}
+		JsonTree parsed(request.body);
+		server->sendReply(request.clientId, ControlServer::toMessageBody(JsonTree::makeObject()
+			.addChild(parsed.getChild("id"))
+			.addChild(JsonTree("ok", true))));
+		numHandled += 1;
+	}
+	return numHandled;
+}
+
+static string makeRequest(int id) {
+	return "{\"id\":" + std::to_string(id) + ",\"cmd\":\"list\"}\n";
+}
+
+static void testRoundTripLatency(ControlServerRef server, uint16_t port) {
+	TestClient client(port);
+	CHECK(client.isConnected());
+
+	int const numRequests = 1000;
+	vector<double> latenciesUs;
+	for (int id = 0; id < numRequests; id++) {
+		auto start = Clock::now();
+		client.send(makeRequest(id));
+		if (handleRequests(server, 1) != 1) {
+			break;
+		}
+		string reply;
+		if (!client.readLine(reply)) {
+			break;
+		}
+		latenciesUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+		CHECK(JsonTree(reply).getValueForKey<int>("id") == id);
+	}
+	CHECK(latenciesUs.size() == numRequests);
+	if (latenciesUs.empty()) {
+		return;
+	}
+
+	std::sort(latenciesUs.begin(), latenciesUs.end());
+	double total = 0.0;
+	for (double latency : latenciesUs) {
+		total += latency;
+	}
+	std::cout << "round trip over loopback: average " << total / latenciesUs.size() << " us, median "
+		<< latenciesUs[latenciesUs.size() / 2] << " us, max " << latenciesUs.back() << " us" << std::endl;
+}
+
+static void testHalfClose(ControlServerRef server, uint16_t port) {
+	// Like printf '...' | nc -N localhost 9100, which stops sending before the replies come back
+	TestClient client(port);
+	CHECK(client.isConnected());
+	client.send(makeRequest(1) + makeRequest(2));
+	client.shutdownWrite();
+
+	CHECK(handleRequests(server, 2) == 2);
+
+	string reply;
+	CHECK(client.readLine(reply) && JsonTree(reply).getValueForKey<int>("id") == 1);
+	CHECK(client.readLine(reply) && JsonTree(reply).getValueForKey<int>("id") == 2);
+	// And then the server hangs up
+	CHECK(!client.readLine(reply));
+}
+
+static void testBusyRepliesKeepIds(ControlServerRef server, uint16_t port) {
+	// More requests than the queue holds, without the render thread picking any of them up
+	TestClient client(port);
+	CHECK(client.isConnected());
+	int const numRequests = 300;
+	string requests;
+	for (int id = 0; id < numRequests; id++) {
+		requests += makeRequest(id);
+	}
+	client.send(requests);
+
+	// The overflow is answered straight away by the network thread
+	vector<int> busyIds;
+	string reply;
+	while ((int) busyIds.size() < numRequests - 256 && client.readLine(reply)) {
+		JsonTree parsed(reply);
+		CHECK(!parsed.getValueForKey<bool>("ok"));
+		CHECK(parsed.getValueForKey("error") == "too many pending requests");
+		busyIds.push_back(parsed.getValueForKey<int>("id"));
+	}
+	CHECK(busyIds.size() == numRequests - 256);
+	CHECK(!busyIds.empty() && busyIds.front() == 256 && busyIds.back() == numRequests - 1);
+
+	CHECK(handleRequests(server, 256) == 256);
+	int numReplies = 0;
+	while (numReplies < 256 && client.readLine(reply)) {
+		CHECK(JsonTree(reply).getValueForKey<int>("id") == numReplies);
+		numReplies += 1;
+	}
+	CHECK(numReplies == 256);
+}
+
+static void testReplyBurst(ControlServerRef server, uint16_t port) {
+	// Far more replies in one go than the outgoing queue holds, like a frame that handles a flood of requests.
+	// None of them can be dropped, and the half-closed client still has to be hung up on once they're all sent.
+	TestClient client(port);
+	CHECK(client.isConnected());
+	int const numRequests = 2000;
+
+	std::atomic<int> numReplies(0);
+	std::atomic<bool> sawHangup(false);
+	std::thread reader([&] () {
+		string reply;
+		while (client.readLine(reply)) {
+			numReplies += 1;
+		}
+		sawHangup = true;
+	});
+
+	// Only a queue's worth of requests are accepted at a time, so they're sent and picked up in batches,
+	// and all answered at the end
+	vector<ControlMessage> requests;
+	auto deadline = Clock::now() + std::chrono::seconds(5);
+	while ((int) requests.size() < numRequests && Clock::now() < deadline) {
+		int batchEnd = std::min((int) requests.size() + 256, numRequests);
+		string batch;
+		for (int id = (int) requests.size(); id < batchEnd; id++) {
+			batch += makeRequest(id);
+		}
+		client.send(batch);
+
+		ControlMessage request;
+		while ((int) requests.size() < batchEnd && Clock::now() < deadline) {
+			if (server->popRequest(request)) {
+				requests.push_back(request);
+			}
+		}
+	}
+	CHECK((int) requests.size() == numRequests);
+	client.shutdownWrite();
+
+	for (auto & request : requests) {
+		server->sendReply(request.clientId, request.body);
+	}
+
+	// Keep calling popRequest(), which is what retries the backlog in the app
+	ControlMessage request;
+	deadline = Clock::now() + std::chrono::seconds(5);
+	while (!sawHangup && Clock::now() < deadline) {
+		server->popRequest(request);
+	}
+	reader.join();
+
+	CHECK(numReplies == numRequests);
+	CHECK(sawHangup);
+}
+
+static void testErrorReplies() {
+	JsonTree reply(ControlServer::makeErrorReply("{\"id\":\"abc\",\"cmd\":\"nope\"}", "unknown command"));
+	CHECK(reply.getValueForKey("id") == "abc");
+	CHECK(!reply.getValueForKey<bool>("ok"));
+	CHECK(reply.getValueForKey("error") == "unknown command");
+
+	// There's no id to echo in something that isn't JSON
+	reply = JsonTree(ControlServer::makeErrorReply("not json", "bad request"));
+	CHECK(!reply.hasChild("id"));
+	CHECK(reply.getValueForKey("error") == "bad request");
+
+	CHECK(ControlServer::toMessageBody(reply).find('\n') == string::npos);
+}
+
+int main() {
+	// Away from the app's own port, so the test can run next to a live instance
+	ControlServerRef server;
+	uint16_t port;
+	for (port = 19100; port < 19110; port++) {
+		server = ControlServer::create(port);
+		if (server->start()) {
+			break;
+		}
+	}
+	if (port == 19110) {
+		std::cerr << "FAILED: could not start the control server" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	testErrorReplies();
+	testRoundTripLatency(server, port);
+	testHalfClose(server, port);
+	testBusyRepliesKeepIds(server, port);
+	testReplyBurst(server, port);
+
+	server->stop();
+
+	return finishTests("control server");
+}
@@ -0,0 +1,170 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cinder/app/KeyEvent.h"
+
+#include "EventLog.h"
+
+#include "TestCheck.h"
+
+using namespace ci;
+using std::string;
+using std::vector;
+
+// Records calibration sessions to a temporary log, and checks that replaying them gives back the same
+// projectors and the same saved params.
+
+static string readFile(fs::path const & file) {
+	std::ifstream readStream(file.string());
+	std::stringstream contents;
+	contents << readStream.rdbuf();
+	return contents.str();
+}
+
+static void writeCubeLut(fs::path const & file) {
+	std::ofstream writeFile(file.string());
+	writeFile << "LUT_3D_SIZE 2\n0 0 0\n1 0 0\n0 1 0\n1 1 0\n0 0 1\n1 0 1\n0 1 1\n1 1 1\n";
+}
+
+static vector<LoggedEvent> replay(EventReplayer & replayer, fs::path const & logFile) {
+	vector<LoggedEvent> events = readEventLog(logFile);
+	for (auto & event : events) {
+		replayer.apply(event);
+	}
+	return events;
+}
+
+static void testRoundTrip(fs::path const & testDir) {
+	fs::path logFile = testDir / "roundTrip.log";
+	writeCubeLut(testDir / "warm.cube");
+
+	Projector projector = Projector().setId(3).setYRotation(1.5f).setUpsideDown(true);
+	ColorCorrection correction;
+	correction.setGamma(vec3(2.2f)).setBaseLut(vector<float>(), 0, "warm.cube");
+
+	// Same as the app: a snapshot of what was loaded, edits, and then the LUT is switched to one that's missing
+	{
+		EventRecorderRef recorder = EventRecorder::create(logFile);
+		recorder->record(EventType::SESSION_START, 0);
+		recorder->recordProjectorSnapshot(projector, correction);
+		recorder->recordProjectorField(3, ProjectorField::HOR_FOV, vec3(0.75f));
+		recorder->recordProjectorField(3, ProjectorField::WHITE_POINT, vec3(0.9f, 1.0f, 0.8f));
+		recorder->record(EventType::KEY_COMMAND, app::KeyEvent::KEY_s, 's');
+		recorder->recordLutFile(3, "missing.cube");
+	}
+
+	vector<LoggedEvent> events = readEventLog(logFile);
+	CHECK(events.size() == 1 + 10 + 2 + 1 + 1);
+	CHECK(!events.empty() && events.back().type == EventType::LUT_FILE && events.back().text == "missing.cube");
+
+	EventReplayer replayer(testDir);
+	replay(replayer, logFile);
+	CHECK(replayer.getProjectors().size() == 1);
+	CHECK(replayer.getNumSaves() == 1);
+	if (replayer.getProjectors().size() == 1) {
+		Projector const & replayed = * replayer.getProjectors()[0];
+		CHECK(replayed.getId() == 3);
+		CHECK(replayed.getYRotation() == 1.5f);
+		CHECK(replayed.getUpsideDown());
+		CHECK(replayed.getHorFOV() == 0.75f);
+
+		ColorCorrection const & replayedCorrection = * replayer.getColorCorrections().at(3);
+		CHECK(replayedCorrection.getGamma().x == 2.2f);
+		CHECK(replayedCorrection.getWhitePoint().b == 0.8f);
+		// The missing LUT keeps its name, but falls back to the identity table
+		CHECK(replayedCorrection.getLutFile() == "missing.cube");
+		CHECK(replayedCorrection.getLutSize() == ColorCorrection::DEFAULT_LUT_SIZE);
+	}
+
+	// The save happened while warm.cube was still in use
+	CHECK(replayer.getLastSavedParams().find("warm.cube") != string::npos);
+
+	// Which is also what replayEventLog writes out
+	fs::path outputFile = testDir / "replayedParams.json";
+	CHECK(replayEventLog(logFile, outputFile, testDir) == EXIT_SUCCESS);
+	CHECK(readFile(outputFile) == replayer.getLastSavedParams());
+
+	// And it reports output it can't write
+	CHECK(replayEventLog(logFile, testDir / "noSuchDir" / "replayedParams.json", testDir) == EXIT_FAILURE);
+}
+
+static void testLoadsLut(fs::path const & testDir) {
+	fs::path logFile = testDir / "lut.log";
+	writeCubeLut(testDir / "warm.cube");
+	{
+		EventRecorderRef recorder = EventRecorder::create(logFile);
+		recorder->record(EventType::SESSION_START, 0);
+		recorder->recordLutFile(1, "warm.cube");
+	}
+
+	EventReplayer replayer(testDir);
+	replay(replayer, logFile);
+	CHECK(replayer.getColorCorrections().count(1) == 1);
+	if (replayer.getColorCorrections().count(1) == 1) {
+		CHECK(replayer.getColorCorrections().at(1)->getLutSize() == 2);
+	}
+}
+
+static void testTruncatedLog(fs::path const & testDir) {
+	fs::path logFile = testDir / "truncated.log";
+	{
+		EventRecorderRef recorder = EventRecorder::create(logFile);
+		recorder->record(EventType::SESSION_START, 0);
+		recorder->recordLutFile(1, "warm.cube");
+	}
+
+	// A crash partway through writing the file name
+	fs::resize_file(logFile, fs::file_size(logFile) - 3);
+	vector<LoggedEvent> events = readEventLog(logFile);
+	CHECK(events.size() == 1);
+	CHECK(!events.empty() && events[0].type == EventType::SESSION_START);
+}
+
+static void testOldLogVersion(fs::path const & testDir) {
+	// A version 1 log with a single SESSION_START record
+	fs::path logFile = testDir / "old.log";
+	{
+		std::ofstream writeFile(logFile.string(), std::ios::binary);
+		uint32_t version = 1;
+		uint64_t timeMicros = 0;
+		EventType type = EventType::SESSION_START;
+		int32_t zero = 0;
+		float values[3] = { 0, 0, 0 };
+		writeFile.write("DLEV", 4);
+		writeFile.write(reinterpret_cast<char const *>(& version), sizeof(version));
+		writeFile.write(reinterpret_cast<char const *>(& timeMicros), sizeof(timeMicros));
+		writeFile.write(reinterpret_cast<char const *>(& type), sizeof(type));
+		writeFile.write(reinterpret_cast<char const *>(& zero), sizeof(zero));
+		writeFile.write(reinterpret_cast<char const *>(& zero), sizeof(zero));
+		writeFile.write(reinterpret_cast<char const *>(values), sizeof(values));
+	}
+	CHECK(readEventLog(logFile).size() == 1);
+
+	// New sessions aren't appended to it, it's moved out of the way
+	{
+		EventRecorderRef recorder = EventRecorder::create(logFile);
+		recorder->record(EventType::SESSION_START, 0);
+	}
+	CHECK(fs::exists(testDir / "old.log.v1"));
+	CHECK(readEventLog(testDir / "old.log.v1").size() == 1);
+	CHECK(readEventLog(logFile).size() == 1);
+}
+
+int main() {
+	fs::path testDir = fs::temp_directory_path() / "eventLogTest";
+	fs::remove_all(testDir);
+	fs::create_directories(testDir);
+
+	testRoundTrip(testDir);
+	testLoadsLut(testDir);
+	testTruncatedLog(testDir);
+	testOldLogVersion(testDir);
+
+	fs::remove_all(testDir);
+
+	return finishTests("event log");
+}
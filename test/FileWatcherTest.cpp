@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "FileWatcher.h"
+
+#include "TestCheck.h"
+
+using namespace ci;
+using std::string;
+using std::vector;
+
+// Drives the file watcher with made up times, so nothing here sleeps, and checks how shader includes
+// are followed into the artifacts that have to be rebuilt.
+
+static void writeFile(fs::path const & file, string const & contents) {
+	std::ofstream writeStream(file.string());
+	writeStream << contents;
+}
+
+static bool contains(vector<fs::path> const & files, fs::path const & file) {
+	return std::find(files.begin(), files.end(), file) != files.end();
+}
+
+static void testDebounce(fs::path const & testDir) {
+	fs::path file = testDir / "params.json";
+	writeFile(file, "{}");
+
+	FileWatcher watcher(0.25);
+	watcher.watch(file);
+	watcher.watch(file);
+	CHECK(watcher.poll(0.0).empty());
+	CHECK(watcher.poll(10.0).empty());
+
+	// An editor saving in several steps. Each write is a different size, so it's seen even when the
+	// modification time doesn't move.
+	writeFile(file, "{ ");
+	CHECK(watcher.poll(20.0).empty());
+	writeFile(file, "{ \"a\"");
+	CHECK(watcher.poll(20.1).empty());
+	writeFile(file, "{ \"a\": 1 }");
+	CHECK(watcher.poll(20.2).empty());
+	CHECK(watcher.poll(20.3).empty());
+	// Reported once, a debounce after the last write
+	vector<fs::path> changed = watcher.poll(20.45);
+	CHECK(changed.size() == 1 && changed[0] == file);
+	CHECK(watcher.poll(21.0).empty());
+
+	// Saved by deleting and re-creating the file
+	fs::remove(file);
+	CHECK(watcher.poll(30.0).empty());
+	writeFile(file, "{ \"a\": 22 }");
+	CHECK(watcher.poll(30.1).empty());
+	changed = watcher.poll(30.35);
+	CHECK(changed.size() == 1 && changed[0] == file);
+
+	// A file that's gone stays pending, however long it's gone for, and is reported once it's back
+	fs::remove(file);
+	CHECK(watcher.poll(40.0).empty());
+	CHECK(watcher.poll(41.0).empty());
+	CHECK(watcher.poll(100.0).empty());
+	writeFile(file, "{ \"a\": 333 }");
+	CHECK(watcher.poll(101.0).empty());
+	changed = watcher.poll(101.25);
+	CHECK(changed.size() == 1 && changed[0] == file);
+}
+
+static void testParseShaderIncludes() {
+	vector<string> includes = parseShaderIncludes(
+		"#version 150\n"
+		"#include \"colorLut_m.glsl\"\n"
+		"  \t#include \"indented.glsl\"\n"
+		"// #include \"commented.glsl\"\n"
+		"#include <angled.glsl>\n"
+		"#include \"unterminated.glsl\n"
+		"void main() {}\n"
+		"#include \"last.glsl\"");
+	CHECK(includes.size() == 3);
+	if (includes.size() == 3) {
+		CHECK(includes[0] == "colorLut_m.glsl");
+		CHECK(includes[1] == "indented.glsl");
+		CHECK(includes[2] == "last.glsl");
+	}
+	CHECK(parseShaderIncludes("").empty());
+}
+
+static void testFindShaderDependencies(fs::path const & testDir) {
+	// A fragment shader including a file in a subdirectory, which includes one next to it
+	fs::create_directories(testDir / "lib");
+	writeFile(testDir / "projector_f.glsl", "#version 150\n#include \"lib/colorLut_m.glsl\"\nvoid main() {}\n");
+	writeFile(testDir / "lib" / "colorLut_m.glsl", "#include \"clamp_m.glsl\"\n");
+	writeFile(testDir / "lib" / "clamp_m.glsl", "float clamp01(float x) { return clamp(x, 0.0, 1.0); }\n");
+
+	vector<fs::path> dependencies = findShaderDependencies(testDir / "projector_f.glsl");
+	CHECK(dependencies.size() == 3);
+	CHECK(!dependencies.empty() && dependencies[0] == testDir / "projector_f.glsl");
+	CHECK(contains(dependencies, testDir / "lib/colorLut_m.glsl"));
+	CHECK(contains(dependencies, testDir / "lib" / "clamp_m.glsl"));
+
+	// Files that include each other are only listed once each
+	writeFile(testDir / "a_m.glsl", "#include \"b_m.glsl\"\n");
+	writeFile(testDir / "b_m.glsl", "#include \"a_m.glsl\"\n#include \"b_m.glsl\"\n");
+	dependencies = findShaderDependencies(testDir / "a_m.glsl");
+	CHECK(dependencies.size() == 2);
+	CHECK(contains(dependencies, testDir / "a_m.glsl") && contains(dependencies, testDir / "b_m.glsl"));
+
+	// A missing include is still a dependency, so creating it triggers a rebuild
+	writeFile(testDir / "missing_f.glsl", "#include \"notYet_m.glsl\"\n");
+	dependencies = findShaderDependencies(testDir / "missing_f.glsl");
+	CHECK(dependencies.size() == 2 && contains(dependencies, testDir / "notYet_m.glsl"));
+}
+
+static void testAffectedArtifacts() {
+	AssetDependencies dependencies;
+	dependencies.setDependencies("projector", { "projector_v.glsl", "projector_f.glsl", "colorLut_m.glsl" });
+	dependencies.setDependencies("preview", { "preview_f.glsl", "colorLut_m.glsl" });
+	dependencies.setDependencies("params", { "projectorParams.json" });
+
+	CHECK(dependencies.getAffectedArtifacts({}).empty());
+	CHECK(dependencies.getAffectedArtifacts({ "unrelated.glsl" }).empty());
+	CHECK(dependencies.getAffectedArtifacts({ "projector_f.glsl" }) == std::set<string>({ "projector" }));
+	// A shared include rebuilds everything that uses it
+	CHECK(dependencies.getAffectedArtifacts({ "colorLut_m.glsl" }) == std::set<string>({ "projector", "preview" }));
+	CHECK(dependencies.getAffectedArtifacts({ "preview_f.glsl", "projectorParams.json" }) == std::set<string>({ "preview", "params" }));
+
+	// Setting them again replaces the old ones
+	dependencies.setDependencies("projector", { "projector_v.glsl", "projector_f.glsl" });
+	CHECK(dependencies.getAffectedArtifacts({ "colorLut_m.glsl" }) == std::set<string>({ "preview" }));
+	CHECK(dependencies.getDependencies("projector").size() == 2);
+	CHECK(dependencies.getDependencies("unknown").empty());
+}
+
+int main() {
+	fs::path testDir = fs::temp_directory_path() / "fileWatcherTest";
+	fs::remove_all(testDir);
+	fs::create_directories(testDir);
+
+	testDebounce(testDir);
+	testParseShaderIncludes();
+	testFindShaderDependencies(testDir);
+	testAffectedArtifacts();
+
+	fs::remove_all(testDir);
+
+	return finishTests("file watcher");
+}
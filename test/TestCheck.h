@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+// The tests are plain executables run by ctest. CHECK() reports a failed condition and carries on,
+// and main() ends with return finishTests(...).
+
+inline int & numFailedChecks() {
+	static int numFailures = 0;
+	return numFailures;
+}
+
+inline void check(bool passed, char const * condition, char const * file, int line) {
+	if (!passed) {
+		std::cerr << "FAILED " << file << ":" << line << ": " << condition << std::endl;
+		numFailedChecks() += 1;
+	}
+}
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+// Exit codes only keep 8 bits, so the number of failures can't be returned as is
+inline int finishTests(char const * testName) {
+	if (numFailedChecks() > 0) {
+		std::cerr << numFailedChecks() << " " << testName << " check(s) failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "all " << testName << " tests passed" << std::endl;
+	return EXIT_SUCCESS;
+}